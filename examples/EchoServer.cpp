@@ -28,6 +28,7 @@ SOFTWARE.
 
 #include <chrono>
 #include <future>
+#include <thread>
 
 using namespace std::chrono_literals;
 
@@ -29,6 +29,7 @@ SOFTWARE.
 #include <future>
 #include <iostream>
 #include <mutex>
+#include <thread>
 #include <iterator>
 #include <array>
 
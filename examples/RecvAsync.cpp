@@ -169,19 +169,13 @@ int main()
       AsyncMessage oMessage( TEST_PACKET );
       if ( oClient.Send( oMessage.GetWireFormat(), oMessage.GetWireFormatSize() ) )   // Send a message the server
       {
-         oClient.Select();
+         // Receive the whole response, waiting up to a second for the server to echo it.
+         const int iBytesReceived = oClient.ReceiveExactly( nullptr, oMessage.GetWireFormatSize(), 1000 );
 
-         size_t iTotalBytes = 0;
-         while ( iTotalBytes != oMessage.GetWireFormatSize() )
+         if ( iBytesReceived > 0 )
          {
-            const int iBytesReceived = oClient.Receive( NEXT_BYTE );   // Receive one byte of response from the server.
-
-            if ( iBytesReceived > 0 )
-            {
-               iTotalBytes += iBytesReceived;
-               std::string sResult = oClient.GetData();
-               printf( "received %d bytes: '%s'\n", iBytesReceived, sResult.c_str() );
-            }
+            std::string sResult = oClient.GetData();
+            printf( "received %d bytes: '%s'\n", iBytesReceived, sResult.c_str() );
          }
       }
    }
@@ -42,6 +42,12 @@
  *----------------------------------------------------------------------------*/
 
 #include "ActiveSocket.h"
+#include "ResolverCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
 
 #ifdef _WIN32
 #include <Ws2tcpip.h>
@@ -52,12 +58,14 @@
 //------------------------------------------------------------------------------
 CActiveSocket::CActiveSocket( CSocketType nType ) : CSimpleSocket( nType ) {}
 
+//------------------------------------------------------------------------------
+CActiveSocket::CActiveSocket( SOCKET socket, CSocketType nType ) : CSimpleSocket( socket, nType ) {}
+
 //------------------------------------------------------------------------------
 bool CActiveSocket::Validate( const char* pAddr, uint16_t nPort )
 {
-   if ( !IsSocketValid() )
+   if ( !EnsureHandle() )
    {
-      SetSocketError( CSimpleSocket::SocketInvalidSocket );
       return false;
    }
 
@@ -77,30 +85,105 @@ bool CActiveSocket::Validate( const char* pAddr, uint16_t nPort )
 }
 
 //------------------------------------------------------------------------------
-bool CActiveSocket::PreConnect( const char* pAddr, uint16_t nPort )
+bool CActiveSocket::Resolve( const char* pAddr, uint16_t nPort, std::vector<sockaddr_in>& addresses )
 {
-   addrinfo hints{ AI_ALL, m_nSocketDomain, 0, 0, 0, nullptr, nullptr, nullptr };
+   std::vector<in_addr> hosts( 1 );
+
+   // A literal address needs neither the resolver nor the cache
+   if ( inet_pton( AF_INET, pAddr, &hosts.front() ) != 1 )
+   {
+      // The cache only holds IPv4 results
+      const bool bCacheable = ( m_nSocketDomain == AF_INET );
+
+      switch ( bCacheable ? CResolverCache::GetShared().Find( pAddr, hosts ) : CResolverCache::LookupMiss )
+      {
+      case CResolverCache::LookupFound:
+         break;
+      case CResolverCache::LookupFailed:
+         SetSocketError( SocketInvalidAddress );
+         return false;
+      case CResolverCache::LookupMiss:
+         if ( !Lookup( pAddr, hosts, bCacheable ) ) return false;
+         break;
+      }
+   }
+
+   addresses.clear();
+   for ( const in_addr& stHost : hosts )
+   {
+      sockaddr_in stAddr = {};
+      stAddr.sin_family = static_cast<decltype( stAddr.sin_family )>( m_nSocketDomain );
+      stAddr.sin_addr = stHost;
+      stAddr.sin_port = htons( nPort );
+      addresses.push_back( stAddr );
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+bool CActiveSocket::Lookup( const char* pAddr, std::vector<in_addr>& hosts, bool bCache )
+{
+   const int nSocketType = ( m_nSocketType == SocketTypeUdp ) ? SOCK_DGRAM : SOCK_STREAM;
+   addrinfo hints{ AI_ALL, m_nSocketDomain, nSocketType, 0, 0, nullptr, nullptr, nullptr };
    addrinfo* pResult = nullptr;
 
    /// https://codereview.stackexchange.com/a/17866
-   if ( getaddrinfo( pAddr, nullptr, &hints, &pResult ) != SocketSuccess )
+   const int nResult = getaddrinfo( pAddr, nullptr, &hints, &pResult );
+   if ( nResult != SocketSuccess )
    {
+      // Only remember names which do not exist, not a resolver which is briefly unavailable
+      if ( bCache && nResult == EAI_NONAME )
+      {
+         CResolverCache::GetShared().Store( pAddr, {} );
+      }
+
 #ifdef _WIN32
       TranslateSocketError();
 #else
       SetSocketError( SocketInvalidAddress );
 #endif
+      return false;
    }
-   else
+
+   hosts.clear();
+   for ( const addrinfo* pInfo = pResult; pInfo != nullptr; pInfo = pInfo->ai_next )
    {
-      m_stServerSockaddr.sin_family = static_cast<decltype( m_stServerSockaddr.sin_family )>( m_nSocketDomain ),
-      m_stServerSockaddr.sin_addr = reinterpret_cast<sockaddr_in*>( pResult->ai_addr )->sin_addr;   // NOLINT
-      m_stServerSockaddr.sin_port = htons( nPort ),
-      freeaddrinfo( pResult );
-      return true;
+      const in_addr stHost = reinterpret_cast<sockaddr_in*>( pInfo->ai_addr )->sin_addr;   // NOLINT
+
+      const bool bDuplicate = std::any_of( hosts.begin(), hosts.end(), [&stHost]( const in_addr& other ) {
+         return other.s_addr == stHost.s_addr;
+      } );
+      if ( !bDuplicate ) hosts.push_back( stHost );
    }
 
-   return false;
+   freeaddrinfo( pResult );
+
+   if ( bCache )
+   {
+      CResolverCache::GetShared().Store( pAddr, hosts );
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+bool CActiveSocket::PreConnect( const char* pAddr, uint16_t nPort )
+{
+   std::vector<sockaddr_in> addresses;
+   if ( !Resolve( pAddr, nPort, addresses ) )
+   {
+      return false;
+   }
+
+   if ( addresses.empty() )
+   {
+      SetSocketError( SocketInvalidAddress );
+      return false;
+   }
+
+   m_stServerSockaddr = addresses.front();
+   return true;
 }
 
 //------------------------------------------------------------------------------
@@ -118,14 +201,14 @@ bool CActiveSocket::ConnectStreamSocket()
 
       //--------------------------------------------------------------
       // If the socket is non-blocking and the current socket error
-      // is SocketEinprogress or SocketEwouldblock then poll connection
-      // with select for designated timeout period.
+      // is SocketEinprogress or SocketEwouldblock then wait for the
+      // connection to become writable for designated timeout period.
       // Linux returns EINPROGRESS and Windows returns WSAEWOULDBLOCK.
       //--------------------------------------------------------------
       if ( ( IsNonblocking() ) && ( ( GetSocketError() == CSimpleSocket::SocketEwouldblock ) ||
                                     ( GetSocketError() == CSimpleSocket::SocketEinprogress ) ) )
       {
-         bRetVal = Select( GetConnectTimeoutSec(), GetConnectTimeoutUSec() );
+         bRetVal = Select( ReadinessWritable, GetConnectTimeoutSec(), GetConnectTimeoutUSec() );
       }
    }
    else
@@ -151,6 +234,214 @@ bool CActiveSocket::ConnectDatagramSocket()
    return bRetVal;
 }
 
+//------------------------------------------------------------------------------
+bool CActiveSocket::ConnectRacing( const std::vector<sockaddr_in>& addresses, int32_t nAttemptDelayMs )
+{
+   const bool bIsBlocking = !IsNonblocking();
+   if ( bIsBlocking && !SetNonblocking() )
+   {
+      return false;
+   }
+
+   const auto nTimeout = std::chrono::milliseconds( GetConnectTimeoutSec() * 1000 + GetConnectTimeoutUSec() / 1000 );
+   const auto start = std::chrono::steady_clock::now();
+   auto nextAttempt = start;
+
+   std::vector<std::unique_ptr<CActiveSocket>> spares;   // Own the sockets for every address but the first
+   std::vector<CActiveSocket*> pending;                  // Attempts still connecting, in step with polls
+   std::vector<pollfd> polls;
+   CActiveSocket* pWinner = nullptr;
+   CSocketError nLastError = SocketConnectionRefused;
+   size_t nNext = 0;
+
+   m_timer.SetStartTime();
+
+   while ( pWinner == nullptr && ( nNext < addresses.size() || !pending.empty() ) )
+   {
+      const auto now = std::chrono::steady_clock::now();
+      if ( nTimeout.count() > 0 && now - start >= nTimeout )
+      {
+         nLastError = SocketTimedout;
+         break;
+      }
+
+      // Each attempt gets a head start before the next address joins the race
+      if ( nNext < addresses.size() && ( pending.empty() || now >= nextAttempt ) )
+      {
+         CActiveSocket* pAttempt = this;
+         if ( nNext > 0 )
+         {
+            try
+            {
+               spares.push_back( std::make_unique<CActiveSocket>( m_nSocketType ) );
+            }
+            catch ( const std::runtime_error& )
+            {
+               nLastError = SocketInvalidSocket;   // Out of descriptors, carry on with those started
+               nNext = addresses.size();
+               continue;
+            }
+
+            pAttempt = spares.back().get();
+            pAttempt->SetNonblocking();
+         }
+
+         const sockaddr_in& stAddr = addresses[ nNext++ ];
+         nextAttempt = now + std::chrono::milliseconds( nAttemptDelayMs );
+
+         if ( CONNECT( pAttempt->m_socket, &stAddr, SOCKET_ADDR_IN_SIZE ) == SocketSuccess )
+         {
+            pWinner = pAttempt;
+            break;
+         }
+
+         pAttempt->TranslateSocketError();
+         if ( pAttempt->GetSocketError() == SocketEinprogress || pAttempt->GetSocketError() == SocketEwouldblock )
+         {
+            pending.push_back( pAttempt );
+            polls.push_back( { pAttempt->m_socket, POLLOUT, 0 } );
+         }
+         else
+         {
+            nLastError = pAttempt->GetSocketError();
+         }
+
+         continue;
+      }
+
+      // Wait until an attempt completes, the next one is due or the race times out
+      auto wait = std::chrono::milliseconds( -1 );
+      if ( nNext < addresses.size() )
+      {
+         wait = std::chrono::duration_cast<std::chrono::milliseconds>( nextAttempt - now );
+      }
+      if ( nTimeout.count() > 0 )
+      {
+         const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>( start + nTimeout - now );
+         wait = ( wait.count() < 0 ) ? remaining : std::min( wait, remaining );
+      }
+
+      const int32_t nWaitMs = ( wait.count() < 0 ) ? -1 : static_cast<int32_t>( wait.count() ) + 1;
+      if ( POLL( polls.data(), polls.size(), nWaitMs ) == SocketError )
+      {
+         TranslateSocketError();
+         if ( GetSocketError() == SocketInterrupted ) continue;
+
+         nLastError = GetSocketError();
+         break;
+      }
+
+      for ( size_t i = 0; i < polls.size(); )
+      {
+         if ( polls[ i ].revents == 0 )
+         {
+            ++i;
+            continue;
+         }
+
+         int32_t nError = 0;
+         socklen_t nLen = sizeof( nError );
+         if ( GETSOCKOPT( polls[ i ].fd, SOL_SOCKET, SO_ERROR, &nError, &nLen ) == SocketSuccess && nError == 0 &&
+              ( polls[ i ].revents & POLLOUT ) )
+         {
+            pWinner = pending[ i ];
+            break;
+         }
+
+         errno = nError;
+         pending[ i ]->TranslateSocketError();
+         nLastError = ( nError == 0 ) ? SocketConnectionRefused : pending[ i ]->GetSocketError();
+
+         pending.erase( pending.begin() + i );
+         polls.erase( polls.begin() + i );
+         nextAttempt = now;   // A failure starts the next attempt right away
+      }
+   }
+
+   m_timer.SetEndTime();
+
+   // The losing handles, including ours if it lost, are closed along with the spares
+   if ( pWinner != nullptr && pWinner != this )
+   {
+      std::swap( m_socket, pWinner->m_socket );
+   }
+
+   if ( bIsBlocking )
+   {
+      SetBlocking();
+   }
+
+   SetSocketError( pWinner != nullptr ? SocketSuccess : nLastError );
+   return pWinner != nullptr;
+}
+
+//------------------------------------------------------------------------------
+bool CActiveSocket::StartConnect( in_addr stHost, uint16_t nPort )
+{
+   m_stServerSockaddr = {};
+   m_stServerSockaddr.sin_family = AF_INET;
+   m_stServerSockaddr.sin_addr = stHost;
+   m_stServerSockaddr.sin_port = htons( nPort );
+
+   m_timer.SetStartTime();
+   const bool bConnected = ( CONNECT( m_socket, &m_stServerSockaddr, SOCKET_ADDR_IN_SIZE ) == SocketSuccess );
+   TranslateSocketError();
+   m_timer.SetEndTime();
+
+   if ( !bConnected && GetSocketError() != SocketEinprogress && GetSocketError() != SocketEwouldblock )
+   {
+      return false;
+   }
+
+   // The local address is bound as soon as the connect starts
+   socklen_t nSockLen = SOCKET_ADDR_IN_SIZE;
+   GETSOCKNAME( m_socket, &m_stClientSockaddr, &nSockLen );
+
+   SetSocketError( bConnected ? SocketSuccess : SocketEinprogress );
+   return true;
+}
+
+//------------------------------------------------------------------------------
+void CActiveSocket::SaveConnectedAddresses()
+{
+   socklen_t nSockLen = SOCKET_ADDR_IN_SIZE;
+
+   memset( &m_stServerSockaddr, 0, SOCKET_ADDR_IN_SIZE );
+   GETPEERNAME( m_socket, &m_stServerSockaddr, &nSockLen );
+
+   memset( &m_stClientSockaddr, 0, SOCKET_ADDR_IN_SIZE );
+   GETSOCKNAME( m_socket, &m_stClientSockaddr, &nSockLen );
+}
+
+//------------------------------------------------------------------------------
+bool CActiveSocket::Open( const char* pAddr, uint16_t nPort, COpenMode nMode, int32_t nAttemptDelayMs )
+{
+   if ( nMode == OpenFirstAddress || m_nSocketType != SocketTypeTcp )
+   {
+      return Open( pAddr, nPort );
+   }
+
+   std::vector<sockaddr_in> addresses;
+   if ( !Validate( pAddr, nPort ) || !Resolve( pAddr, nPort, addresses ) )
+   {
+      return false;
+   }
+
+   if ( addresses.empty() )
+   {
+      SetSocketError( SocketInvalidAddress );
+      return false;
+   }
+
+   const bool bRetVal = ConnectRacing( addresses, nAttemptDelayMs );
+   if ( bRetVal )
+   {
+      SaveConnectedAddresses();
+   }
+
+   return bRetVal;
+}
+
 //------------------------------------------------------------------------------
 bool CActiveSocket::Open( const char* pAddr, uint16_t nPort )
 {
@@ -172,13 +463,7 @@ bool CActiveSocket::Open( const char* pAddr, uint16_t nPort )
    // If successful then get a local copy of the address and port
    if ( bRetVal )
    {
-      socklen_t nSockLen = SOCKET_ADDR_IN_SIZE;
-
-      memset( &m_stServerSockaddr, 0, SOCKET_ADDR_IN_SIZE );
-      GETPEERNAME( m_socket, &m_stServerSockaddr, &nSockLen );
-
-      memset( &m_stClientSockaddr, 0, SOCKET_ADDR_IN_SIZE );
-      GETSOCKNAME( m_socket, &m_stClientSockaddr, &nSockLen );
+      SaveConnectedAddresses();
    }
    else
    {
@@ -197,5 +482,5 @@ sockaddr_in* CActiveSocket::GetUdpRxAddrBuffer()
 //------------------------------------------------------------------------------
 sockaddr_in* CActiveSocket::GetUdpTxAddrBuffer()
 {
-   return m_bIsMulticast ? &m_stMulticastGroup : &m_stServerSockaddr;
+   return m_bIsMulticast ? &GetMutableSettings().stMulticastGroup : &m_stServerSockaddr;
 }
@@ -6,24 +6,64 @@
 
 #include "SimpleSocket.h"
 
+#include <vector>
+
 class CActiveSocket : public CSimpleSocket
 {
 public:
    friend class CPassiveSocket;
+   friend class CIoUring;
+   friend class CResolver;
+
+   /// How Open() connects when the name resolves to several addresses.
+   enum COpenMode
+   {
+      OpenFirstAddress,   ///< Only try the address the resolver prefers.
+      OpenRaceAddresses   ///< Start staggered connects to every address, keep the first to succeed.
+   };
+
+   /// Delay before racing the next address, as recommended by RFC 8305.
+   static constexpr int32_t ATTEMPT_DELAY_MS = 250;
 
    explicit CActiveSocket( CSocketType type = SocketTypeTcp );
 
+   /// Take ownership of a connected handle, see CSimpleSocket( SOCKET, CSocketType ).
+   CActiveSocket( SOCKET socket, CSocketType type );
+
    bool Open( const char* pAddr, uint16_t nPort );
 
+   /// Open a connection, with CActiveSocket::OpenRaceAddresses a dead address no longer stalls
+   /// the connection for the whole connect timeout. Each attempt gets nAttemptDelayMs to
+   /// complete before the next address is tried alongside it, and a failed attempt starts the
+   /// next one right away. The connect timeout, when set, bounds the whole race.
+   /// Only CSocketType::SocketTypeTcp sockets race, others behave as Open( pAddr, nPort ).
+   /// <br/><br/>\b NOTE: The first address connects with this socket, later ones with new
+   /// sockets which only share the blocking mode. Options set before Open() are lost if one of
+   /// those wins.
+   bool Open( const char* pAddr, uint16_t nPort, COpenMode nMode, int32_t nAttemptDelayMs = ATTEMPT_DELAY_MS );
+
 protected:
    sockaddr_in* GetUdpRxAddrBuffer() override;
    sockaddr_in* GetUdpTxAddrBuffer() override;
 
+   /// Look up every IPv4 address of pAddr, in the order the resolver prefers, without duplicates.
+   /// Literal addresses are converted directly and names go through CResolverCache first.
+   bool Resolve( const char* pAddr, uint16_t nPort, std::vector<sockaddr_in>& addresses );
+
+   /// Race non-blocking connects to the addresses, see Open(). Adopts the winning handle.
+   bool ConnectRacing( const std::vector<sockaddr_in>& addresses, int32_t nAttemptDelayMs );
+
 private:
    bool Validate( const char* pAddr, uint16_t nPort );
+   bool Lookup( const char* pAddr, std::vector<in_addr>& hosts, bool bCache );   // Ask the system resolver
    bool PreConnect( const char* pAddr, uint16_t nPort );   // Convert and Save params for OS layer
    bool ConnectStreamSocket();
    bool ConnectDatagramSocket();
+   void SaveConnectedAddresses();
+
+   /// Start a non-blocking connect to an address which is already resolved.
+   /// @return true if connected or CSimpleSocket::SocketEinprogress is set.
+   bool StartConnect( in_addr stHost, uint16_t nPort );
 };
 
 #endif   //  __ACTIVESOCKET_H__
@@ -0,0 +1,221 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __BASICSOCKET_H__
+#define __BASICSOCKET_H__
+
+#include "SimpleSocket.h"
+
+#include <stdexcept>
+#include <utility>
+
+/// Protocols for CBasicSocket, fixing at compile time what CSimpleSocket decides from its type.
+struct CTcpProtocol
+{
+   static constexpr CSimpleSocket::CSocketType TYPE = CSimpleSocket::SocketTypeTcp;
+
+   static int32_t Send( SOCKET socket, const uint8_t* pBuf, size_t nBytes, int32_t nFlags, const sockaddr_in& )
+   {
+      return static_cast<int32_t>( SEND( socket, pBuf, nBytes, nFlags ) );
+   }
+
+   static int32_t Receive( SOCKET socket, uint8_t* pBuf, uint32_t nMaxBytes, sockaddr_in& )
+   {
+      return static_cast<int32_t>( RECV( socket, pBuf, nMaxBytes, 0 ) );
+   }
+};
+
+struct CUdpProtocol
+{
+   static constexpr CSimpleSocket::CSocketType TYPE = CSimpleSocket::SocketTypeUdp;
+
+   static int32_t Send( SOCKET socket, const uint8_t* pBuf, size_t nBytes, int32_t nFlags, const sockaddr_in& stPeer )
+   {
+      return static_cast<int32_t>(
+          SENDTO( socket, pBuf, nBytes, nFlags, reinterpret_cast<const sockaddr*>( &stPeer ), sizeof( stPeer ) ) );
+   }
+
+   static int32_t Receive( SOCKET socket, uint8_t* pBuf, uint32_t nMaxBytes, sockaddr_in& stSource )
+   {
+      socklen_t nSourceSize = sizeof( stSource );
+      return static_cast<int32_t>( RECVFROM( socket, pBuf, nMaxBytes, 0, &stSource, &nSourceSize ) );
+   }
+};
+
+/// Timing policy which measures nothing, CStatTimer is the one that does.
+struct CNoTiming
+{
+   void SetStartTime() {}
+   void SetEndTime() {}
+};
+
+/// Error policy which keeps the last result as a CSimpleSocket::CSocketError, like CSimpleSocket.
+class CSocketErrors
+{
+public:
+   [[nodiscard]] CSimpleSocket::CSocketError GetSocketError() const { return m_error; }
+
+protected:
+   void OnResult( int32_t nResult )
+   {
+      m_error = ( nResult >= 0 ) ? CSimpleSocket::SocketSuccess : CSimpleSocket::GetLastSystemError();
+   }
+
+private:
+   CSimpleSocket::CSocketError m_error = CSimpleSocket::SocketSuccess;
+};
+
+/// Error policy which leaves failures in errno, for callers which only look at the return value.
+struct CSystemErrors
+{
+protected:
+   void OnResult( int32_t ) {}
+};
+
+/// Socket whose protocol, timing and error reporting are chosen at compile time, so Send() and
+/// Receive() compile down to the system call. CSimpleSocket remains the class to set up a
+/// connection with, this takes it over once it is opened or accepted. Whatever the policies
+/// provide, such as CStatTimer::GetMicroSeconds() or CSocketErrors::GetSocketError(), is
+/// available on the socket.
+template <class Protocol, class TimingPolicy = CNoTiming, class ErrorPolicy = CSocketErrors>
+class CBasicSocket : public TimingPolicy, public ErrorPolicy
+{
+public:
+   /// Take over the handle of a socket, which is left closed. Datagrams are sent to where the
+   /// socket would have sent them.
+   explicit CBasicSocket( CSimpleSocket&& socket )
+   {
+      if ( !socket.IsSocketValid() || socket.GetSocketType() != Protocol::TYPE )
+      {
+         throw std::runtime_error( "Failed to create CBasicSocket! The socket is not open with this protocol" );
+      }
+
+      m_stPeer = *socket.GetUdpTxAddrBuffer();
+      m_socket = socket.m_socket;
+      socket.m_socket = INVALID_SOCKET;
+   }
+
+   CBasicSocket( const CBasicSocket& ) = delete;
+   CBasicSocket& operator=( const CBasicSocket& ) = delete;
+
+   CBasicSocket( CBasicSocket&& other ) noexcept
+       : TimingPolicy( other ),
+         ErrorPolicy( other ),
+         m_socket( other.m_socket ),
+         m_stPeer( other.m_stPeer ),
+         m_stSource( other.m_stSource )
+   {
+      other.m_socket = INVALID_SOCKET;
+   }
+
+   /// Close the current handle and take over the one of other, which is left closed.
+   CBasicSocket& operator=( CBasicSocket&& other ) noexcept
+   {
+      if ( this != &other )
+      {
+         Close();
+         TimingPolicy::operator=( other );
+         ErrorPolicy::operator=( other );
+         std::swap( m_socket, other.m_socket );
+         std::swap( m_stPeer, other.m_stPeer );
+         std::swap( m_stSource, other.m_stSource );
+      }
+
+      return *this;
+   }
+
+   ~CBasicSocket() { Close(); }
+
+   /// @return number of bytes sent or CSimpleSocket::SocketError.
+   int32_t Send( const uint8_t* pBuf, size_t nBytes, uint32_t nSendFlags = CSimpleSocket::SendDefault )
+   {
+      int32_t nFlags = 0;
+#ifdef MSG_MORE
+      if ( nSendFlags & CSimpleSocket::SendMore ) nFlags |= MSG_MORE;
+#endif
+
+      this->SetStartTime();
+      int32_t nSent = 0;
+      do
+      {
+         nSent = Protocol::Send( m_socket, pBuf, nBytes, nFlags, m_stPeer );
+      } while ( nSent == CSimpleSocket::SocketError && errno == EINTR );
+      this->SetEndTime();
+
+      this->OnResult( nSent );
+      return nSent;
+   }
+
+   /// @return number of bytes received, 0 once the stream is closed, or CSimpleSocket::SocketError.
+   int32_t Receive( uint8_t* pBuf, uint32_t nMaxBytes )
+   {
+      this->SetStartTime();
+      int32_t nReceived = 0;
+      do
+      {
+         nReceived = Protocol::Receive( m_socket, pBuf, nMaxBytes, m_stSource );
+      } while ( nReceived == CSimpleSocket::SocketError && errno == EINTR );
+      this->SetEndTime();
+
+      this->OnResult( nReceived );
+      return nReceived;
+   }
+
+   bool Close()
+   {
+      if ( m_socket == INVALID_SOCKET )
+      {
+         return false;
+      }
+
+      const bool bRetVal = ( CLOSE( m_socket ) == CSimpleSocket::SocketSuccess );
+      m_socket = INVALID_SOCKET;
+      return bRetVal;
+   }
+
+   [[nodiscard]] bool IsSocketValid() const { return m_socket != INVALID_SOCKET; }
+   [[nodiscard]] SOCKET GetSocketHandle() const { return m_socket; }
+
+   /// @return address datagrams are sent to. Receiving never changes it, a datagram from
+   /// anyone else must not redirect what is sent.
+   [[nodiscard]] const sockaddr_in& GetPeer() const { return m_stPeer; }
+
+   /// Send datagrams somewhere else, for instance SetPeer( GetSource() ) to reply.
+   void SetPeer( const sockaddr_in& stPeer ) { m_stPeer = stPeer; }
+
+   /// @return address the last datagram received came from.
+   [[nodiscard]] const sockaddr_in& GetSource() const { return m_stSource; }
+
+private:
+   SOCKET m_socket = INVALID_SOCKET;
+   sockaddr_in m_stPeer = {};     /// destination of Send()
+   sockaddr_in m_stSource = {};   /// sender of the last Receive()
+};
+
+using CTcpSocket = CBasicSocket<CTcpProtocol>;
+using CUdpSocket = CBasicSocket<CUdpProtocol>;
+
+#endif   // __BASICSOCKET_H__
@@ -0,0 +1,234 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "ConnectionPool.h"
+
+#include <algorithm>
+#include <vector>
+
+//-------------------------------------------------------------------------------------------------
+CConnectionPool::CConnectionPool( size_t nMinIdle, size_t nMaxIdle, std::chrono::milliseconds idleTimeout )
+    : m_nMinIdle( nMinIdle ), m_nMaxIdle( std::max( nMinIdle, nMaxIdle ) ), m_idleTimeout( idleTimeout )
+{
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Acquire()
+//
+//-------------------------------------------------------------------------------------------------
+std::unique_ptr<CActiveSocket> CConnectionPool::Acquire( const char* pAddr, uint16_t nPort )
+{
+   std::vector<std::unique_ptr<CActiveSocket>> dead;   // Closed once the lock is released
+
+   {
+      std::lock_guard<std::mutex> lock( m_mutex );
+
+      const auto itor = m_idle.find( MakeKey( pAddr, nPort ) );
+      if ( itor != m_idle.end() )
+      {
+         // The most recently used connection is the least likely to have been dropped, one idle
+         // past the timeout may have been forgotten by the server or a middlebox already
+         const Clock::time_point now = Clock::now();
+         auto& idle = itor->second;
+         while ( !idle.empty() )
+         {
+            const bool bExpired = ( now - idle.back().since >= m_idleTimeout );
+            std::unique_ptr<CActiveSocket> pSocket = std::move( idle.back().pSocket );
+            idle.pop_back();
+
+            if ( !bExpired && IsAlive( *pSocket ) )
+            {
+               return pSocket;
+            }
+
+            dead.push_back( std::move( pSocket ) );
+         }
+      }
+   }
+
+   return Connect( pAddr, nPort );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Release()
+//
+//-------------------------------------------------------------------------------------------------
+void CConnectionPool::Release( const char* pAddr, uint16_t nPort, std::unique_ptr<CActiveSocket> pSocket )
+{
+   if ( pSocket == nullptr || !IsAlive( *pSocket ) )
+   {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock( m_mutex );
+
+   auto& idle = m_idle[ MakeKey( pAddr, nPort ) ];
+   if ( idle.size() < m_nMaxIdle )
+   {
+      idle.push_back( { std::move( pSocket ), Clock::now() } );
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Warm()
+//
+//-------------------------------------------------------------------------------------------------
+size_t CConnectionPool::Warm( const char* pAddr, uint16_t nPort )
+{
+   for ( size_t nIdle = GetIdleCount( pAddr, nPort ); nIdle < m_nMinIdle; ++nIdle )
+   {
+      std::unique_ptr<CActiveSocket> pSocket = Connect( pAddr, nPort );
+      if ( pSocket == nullptr )
+      {
+         break;
+      }
+
+      Release( pAddr, nPort, std::move( pSocket ) );
+   }
+
+   return GetIdleCount( pAddr, nPort );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Evict()
+//
+//-------------------------------------------------------------------------------------------------
+size_t CConnectionPool::Evict()
+{
+   std::vector<std::unique_ptr<CActiveSocket>> closed;   // Closed once the lock is released
+
+   {
+      std::lock_guard<std::mutex> lock( m_mutex );
+
+      const auto now = Clock::now();
+      for ( auto& endpoint : m_idle )
+      {
+         auto& idle = endpoint.second;
+
+         // Oldest first, so the minimum kept are the most recently used
+         for ( auto itor = idle.begin(); itor != idle.end(); )
+         {
+            const bool bExpired = ( now - itor->since >= m_idleTimeout ) && ( idle.size() > m_nMinIdle );
+            if ( bExpired || !IsAlive( *itor->pSocket ) )
+            {
+               closed.push_back( std::move( itor->pSocket ) );
+               itor = idle.erase( itor );
+            }
+            else
+            {
+               ++itor;
+            }
+         }
+      }
+   }
+
+   return closed.size();
+}
+
+//-------------------------------------------------------------------------------------------------
+size_t CConnectionPool::GetIdleCount( const char* pAddr, uint16_t nPort ) const
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+
+   const auto itor = m_idle.find( MakeKey( pAddr, nPort ) );
+   return ( itor != m_idle.end() ) ? itor->second.size() : 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint64_t CConnectionPool::GetOpenedCount() const
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   return m_nOpened;
+}
+
+//-------------------------------------------------------------------------------------------------
+CSimpleSocket::CSocketError CConnectionPool::GetLastError() const
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   return m_nLastError;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// IsAlive()
+//
+//-------------------------------------------------------------------------------------------------
+bool CConnectionPool::IsAlive( CSimpleSocket& socket )
+{
+   if ( !socket.IsSocketValid() )
+   {
+      return false;
+   }
+
+   // An idle connection has nothing to read, readable means the remote closed it or sent
+   // something nobody asked for. Either way the stream is no longer at a request boundary,
+   // so there is no need to peek at which it was.
+   return !socket.Select( CSimpleSocket::ReadinessReadable, 0, 0 ) &&
+          socket.GetSocketError() == CSimpleSocket::SocketTimedout;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string CConnectionPool::MakeKey( const char* pAddr, uint16_t nPort )
+{
+   return std::string( pAddr != nullptr ? pAddr : "" ) + ":" + std::to_string( nPort );
+}
+
+//-------------------------------------------------------------------------------------------------
+std::unique_ptr<CActiveSocket> CConnectionPool::Connect( const char* pAddr, uint16_t nPort )
+{
+   std::unique_ptr<CActiveSocket> pSocket;
+   CSimpleSocket::CSocketError nError = CSimpleSocket::SocketSuccess;
+
+   try
+   {
+      pSocket = std::make_unique<CActiveSocket>();
+      if ( !pSocket->Open( pAddr, nPort ) )
+      {
+         nError = pSocket->GetSocketError();
+         pSocket.reset();
+      }
+   }
+   catch ( const std::runtime_error& )
+   {
+      nError = CSimpleSocket::SocketInvalidSocket;   // Out of descriptors
+   }
+
+   std::lock_guard<std::mutex> lock( m_mutex );
+   if ( pSocket != nullptr )
+   {
+      ++m_nOpened;
+   }
+   else
+   {
+      m_nLastError = nError;
+   }
+
+   return pSocket;
+}
@@ -0,0 +1,108 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __CONNECTIONPOOL_H__
+#define __CONNECTIONPOOL_H__
+
+#include "ActiveSocket.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Keeps connected sockets per endpoint so repeated requests to the same backend skip the
+/// connection setup. Sockets are handed out with Acquire() and given back with Release(),
+/// idle ones are checked to still be open before they are reused. Safe to use from several
+/// threads, connecting is done without holding the pool's lock.
+/// <br/><br/>\b NOTE: Only idle connections are capped. Connections handed out are not counted,
+/// so a burst of Acquire() calls opens as many connections to the endpoint as it asks for.
+class CConnectionPool
+{
+public:
+   /// @param nMinIdle connections per endpoint Warm() opens and Evict() keeps.
+   /// @param nMaxIdle connections per endpoint kept for reuse, others are closed on Release().
+   /// @param idleTimeout how long a connection may sit unused before it is no longer reused.
+   explicit CConnectionPool( size_t nMinIdle = 0, size_t nMaxIdle = 8,
+                             std::chrono::milliseconds idleTimeout = std::chrono::seconds( 60 ) );
+
+   /// Hand out an idle connection to the endpoint, or open a new one when there is none, however
+   /// many are already in use. Idle connections past idleTimeout are closed rather than handed out.
+   /// @return nullptr if a new connection could not be opened, see GetLastError().
+   std::unique_ptr<CActiveSocket> Acquire( const char* pAddr, uint16_t nPort );
+
+   /// Give back a connection for reuse, it is closed instead if it failed or the endpoint
+   /// already has nMaxIdle idle connections. A connection which is not released is simply closed.
+   void Release( const char* pAddr, uint16_t nPort, std::unique_ptr<CActiveSocket> pSocket );
+
+   /// Open connections until the endpoint has nMinIdle idle ones, for instance at startup.
+   /// @return number of idle connections to the endpoint.
+   size_t Warm( const char* pAddr, uint16_t nPort );
+
+   /// Close idle connections which timed out or were closed by the remote, keeping nMinIdle
+   /// of those still open per endpoint.
+   /// @return number of connections closed.
+   size_t Evict();
+
+   [[nodiscard]] size_t GetIdleCount( const char* pAddr, uint16_t nPort ) const;
+
+   /// @return number of connections the pool has opened.
+   [[nodiscard]] uint64_t GetOpenedCount() const;
+
+   /// @return reason the last new connection could not be opened.
+   [[nodiscard]] CSimpleSocket::CSocketError GetLastError() const;
+
+   /// Cheap check of an idle connection, without blocking or consuming data. A live connection
+   /// is left with CSimpleSocket::SocketTimedout from the check.
+   /// @return false if the remote closed it, it failed, or unexpected data is waiting on it.
+   static bool IsAlive( CSimpleSocket& socket );
+
+private:
+   using Clock = std::chrono::steady_clock;
+
+   struct CIdle
+   {
+      std::unique_ptr<CActiveSocket> pSocket;
+      Clock::time_point since;   /// when it was released
+   };
+
+   static std::string MakeKey( const char* pAddr, uint16_t nPort );
+
+   /// Connect a new socket, without holding the lock.
+   std::unique_ptr<CActiveSocket> Connect( const char* pAddr, uint16_t nPort );
+
+   mutable std::mutex m_mutex;
+   std::unordered_map<std::string, std::deque<CIdle>> m_idle;   /// most recently released at the back
+   size_t m_nMinIdle;
+   size_t m_nMaxIdle;
+   std::chrono::milliseconds m_idleTimeout;
+   uint64_t m_nOpened = 0;
+   CSimpleSocket::CSocketError m_nLastError = CSimpleSocket::SocketSuccess;
+};
+
+#endif   // __CONNECTIONPOOL_H__
@@ -0,0 +1,92 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __DATAVIEW_H__
+#define __DATAVIEW_H__
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#ifdef STRING_VIEW
+#include <string_view>
+#endif
+
+/// Non-owning view of the bytes held by a socket's internal buffer, see CSimpleSocket::GetData().
+/// Only valid until the next Receive() on that socket. Converts to std::string where a copy is
+/// wanted, so existing callers keep working.
+class CDataView
+{
+public:
+   CDataView() = default;
+   CDataView( const char* pData, size_t nLength ) : m_pData( pData != nullptr ? pData : "" ), m_nLength( nLength ) {}
+
+   [[nodiscard]] const char* data() const { return m_pData; }
+   [[nodiscard]] size_t size() const { return m_nLength; }
+   [[nodiscard]] size_t length() const { return m_nLength; }
+   [[nodiscard]] bool empty() const { return m_nLength == 0; }
+
+   [[nodiscard]] const char* begin() const { return m_pData; }
+   [[nodiscard]] const char* end() const { return m_pData + m_nLength; }
+   char operator[]( size_t nIndex ) const { return m_pData[ nIndex ]; }
+
+   /// The socket keeps a terminator after the received bytes, so this is always a valid C string.
+   [[nodiscard]] const char* c_str() const { return m_nLength > 0 ? m_pData : ""; }
+
+   operator std::string() const { return { m_pData, m_nLength }; }
+#ifdef STRING_VIEW
+   operator std::string_view() const { return { m_pData, m_nLength }; }
+#endif
+
+   friend bool operator==( const CDataView& lhs, const CDataView& rhs )
+   {
+      return lhs.m_nLength == rhs.m_nLength && ( lhs.m_nLength == 0 || std::memcmp( lhs.m_pData, rhs.m_pData, lhs.m_nLength ) == 0 );
+   }
+   friend bool operator==( const CDataView& lhs, const std::string& rhs ) { return lhs == CDataView( rhs.data(), rhs.length() ); }
+   friend bool operator==( const CDataView& lhs, const char* rhs ) { return lhs == CDataView( rhs, std::strlen( rhs ) ); }
+#ifdef STRING_VIEW
+   friend bool operator==( const CDataView& lhs, std::string_view rhs ) { return lhs == CDataView( rhs.data(), rhs.length() ); }
+#endif
+
+   friend bool operator!=( const CDataView& lhs, const CDataView& rhs ) { return !( lhs == rhs ); }
+
+   // Two views go to the overloads above, the templates would otherwise tie with each other
+   template <typename T, typename = std::enable_if_t<!std::is_same<T, CDataView>::value>>
+   friend bool operator==( const T& lhs, const CDataView& rhs ) { return rhs == lhs; }
+   template <typename T, typename = std::enable_if_t<!std::is_same<T, CDataView>::value>>
+   friend bool operator!=( const CDataView& lhs, const T& rhs ) { return !( lhs == rhs ); }
+   template <typename T, typename = std::enable_if_t<!std::is_same<T, CDataView>::value>>
+   friend bool operator!=( const T& lhs, const CDataView& rhs ) { return !( rhs == lhs ); }
+
+   friend std::ostream& operator<<( std::ostream& os, const CDataView& view ) { return os.write( view.m_pData, view.m_nLength ); }
+
+private:
+   const char* m_pData = "";
+   size_t m_nLength = 0;
+};
+
+#endif   // __DATAVIEW_H__
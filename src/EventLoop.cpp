@@ -0,0 +1,232 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "EventLoop.h"
+
+#ifdef _LINUX
+
+#include <sys/eventfd.h>
+
+#include <stdexcept>
+
+CEventLoop::CEventLoop( uint32_t nMaxEventsPerWait ) : m_events( nMaxEventsPerWait > 0 ? nMaxEventsPerWait : 1 )
+{
+   m_epoll = epoll_create1( EPOLL_CLOEXEC );
+   if ( m_epoll == CSimpleSocket::SocketError )
+   {
+      throw std::runtime_error( std::string( "Failed to create event loop! " ) + strerror( errno ) );
+   }
+
+   m_wakeup = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+   epoll_event stEvent{ EPOLLIN, {} };
+   stEvent.data.u64 = EventData( m_wakeup, 0 );
+
+   if ( m_wakeup == CSimpleSocket::SocketError ||
+        epoll_ctl( m_epoll, EPOLL_CTL_ADD, m_wakeup, &stEvent ) == CSimpleSocket::SocketError )
+   {
+      const std::string sReason = strerror( errno );
+      if ( m_wakeup != CSimpleSocket::SocketError ) CLOSE( m_wakeup );
+      CLOSE( m_epoll );
+      throw std::runtime_error( "Failed to create event loop! " + sReason );
+   }
+}
+
+CEventLoop::~CEventLoop()
+{
+   CLOSE( m_wakeup );
+   CLOSE( m_epoll );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Register()
+//
+//-------------------------------------------------------------------------------------------------
+bool CEventLoop::Register( CSimpleSocket& socket, uint32_t nEvents, CHandler handler )
+{
+   if ( !socket.IsSocketValid() )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   if ( !handler || m_registrations.count( socket.m_socket ) != 0 )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidOperation );
+      return false;
+   }
+
+   const uint32_t nGeneration = m_nNextGeneration;
+   m_nNextGeneration = ( m_nNextGeneration == UINT32_MAX ) ? 1 : m_nNextGeneration + 1;
+
+   epoll_event stEvent{ nEvents, {} };
+   stEvent.data.u64 = EventData( socket.m_socket, nGeneration );
+
+   errno = CSimpleSocket::SocketSuccess;
+   const bool bRetVal = ( epoll_ctl( m_epoll, EPOLL_CTL_ADD, socket.m_socket, &stEvent ) == CSimpleSocket::SocketSuccess );
+   socket.TranslateSocketError();
+
+   if ( bRetVal )
+   {
+      m_registrations.emplace( socket.m_socket, std::make_unique<CRegistration>(
+                                                    CRegistration{ &socket, std::move( handler ), nGeneration } ) );
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Modify()
+//
+//-------------------------------------------------------------------------------------------------
+bool CEventLoop::Modify( CSimpleSocket& socket, uint32_t nEvents )
+{
+   const auto itor = m_registrations.find( socket.m_socket );
+   if ( !socket.IsSocketValid() || itor == m_registrations.end() || itor->second->pSocket != &socket )
+   {
+      socket.SetSocketError( socket.IsSocketValid() ? CSimpleSocket::SocketInvalidOperation
+                                                    : CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   epoll_event stEvent{ nEvents, {} };
+   stEvent.data.u64 = EventData( socket.m_socket, itor->second->nGeneration );
+
+   errno = CSimpleSocket::SocketSuccess;
+   const bool bRetVal = ( epoll_ctl( m_epoll, EPOLL_CTL_MOD, socket.m_socket, &stEvent ) == CSimpleSocket::SocketSuccess );
+   socket.TranslateSocketError();
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Unregister()
+//
+//-------------------------------------------------------------------------------------------------
+bool CEventLoop::Unregister( CSimpleSocket& socket )
+{
+   const auto itor = m_registrations.find( socket.m_socket );
+   if ( !socket.IsSocketValid() || itor == m_registrations.end() || itor->second->pSocket != &socket )
+   {
+      socket.SetSocketError( socket.IsSocketValid() ? CSimpleSocket::SocketInvalidOperation
+                                                    : CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   errno = CSimpleSocket::SocketSuccess;
+   const bool bRetVal = ( epoll_ctl( m_epoll, EPOLL_CTL_DEL, socket.m_socket, nullptr ) == CSimpleSocket::SocketSuccess );
+   socket.TranslateSocketError();
+
+   // A handler may be unregistering itself, keep it alive until the dispatch is complete.
+   if ( m_bDispatching ) m_retired.emplace_back( std::move( itor->second ) );
+   m_registrations.erase( itor );
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// RunOnce()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CEventLoop::RunOnce( int32_t nTimeoutMs )
+{
+   int nReady = 0;
+   do
+   {
+      nReady = epoll_wait( m_epoll, m_events.data(), static_cast<int>( m_events.size() ), nTimeoutMs );
+   } while ( nReady == CSimpleSocket::SocketError && errno == EINTR );
+
+   if ( nReady == CSimpleSocket::SocketError )
+   {
+      return CSimpleSocket::SocketError;
+   }
+
+   // Leave the dispatch state even if a handler throws, or later unregistrations would pile up
+   struct CDispatchGuard
+   {
+      CEventLoop& loop;
+      ~CDispatchGuard()
+      {
+         loop.m_bDispatching = false;
+         loop.m_retired.clear();
+      }
+   } guard{ *this };
+
+   int32_t nDispatched = 0;
+   m_bDispatching = true;
+
+   for ( int i = 0; i < nReady; ++i )
+   {
+      const epoll_event& stEvent = m_events[ i ];
+      const SOCKET socket = static_cast<SOCKET>( stEvent.data.u64 & UINT32_MAX );
+      const uint32_t nGeneration = static_cast<uint32_t>( stEvent.data.u64 >> 32 );
+
+      if ( nGeneration == 0 )
+      {
+         uint64_t nCount = 0;
+         (void)read( m_wakeup, &nCount, sizeof( nCount ) );
+         continue;
+      }
+
+      // Lookup rather than carry a pointer in the event, an earlier handler might have unregistered
+      // this socket, and even registered a new one which reuses the handle.
+      const auto itor = m_registrations.find( socket );
+      if ( itor == m_registrations.end() || itor->second->nGeneration != nGeneration )
+      {
+         continue;
+      }
+
+      CRegistration* pRegistration = itor->second.get();
+      pRegistration->handler( *pRegistration->pSocket, stEvent.events );
+      ++nDispatched;
+   }
+
+   return nDispatched;
+}
+
+//-------------------------------------------------------------------------------------------------
+void CEventLoop::Run()
+{
+   while ( !m_bStopRequested && RunOnce() != CSimpleSocket::SocketError )
+   {
+   }
+
+   m_bStopRequested = false;
+}
+
+//-------------------------------------------------------------------------------------------------
+void CEventLoop::Stop()
+{
+   m_bStopRequested = true;
+
+   const uint64_t nIncrement = 1;
+   (void)WRITE( m_wakeup, &nIncrement, sizeof( nIncrement ) );
+}
+
+#endif   // _LINUX
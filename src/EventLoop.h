@@ -0,0 +1,118 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __EVENTLOOP_H__
+#define __EVENTLOOP_H__
+
+#ifdef _LINUX
+
+#include "SimpleSocket.h"
+
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/// Single threaded reactor which watches any number of sockets with one epoll
+/// instance and dispatches a handler when they become ready. Sockets are not owned,
+/// they must be unregistered before they are closed or destroyed.
+class CEventLoop
+{
+public:
+   /// Readiness conditions a socket may be registered for.
+   enum CEvent : uint32_t
+   {
+      EventRead = EPOLLIN,                 ///< Data, a connection or an orderly shutdown is pending.
+      EventWrite = EPOLLOUT,               ///< Space is available in the send buffer or a connect completed.
+      EventError = EPOLLERR | EPOLLHUP,    ///< Always reported by the kernel, no need to register for it.
+      EventEdgeTriggered = EPOLLET         ///< Only notify on transitions, the handler must drain the socket.
+   };
+
+   /// Invoked with the ready socket and the mask of CEvent which occurred.
+   using CHandler = std::function<void( CSimpleSocket&, uint32_t )>;
+
+   explicit CEventLoop( uint32_t nMaxEventsPerWait = 256 );
+   CEventLoop( const CEventLoop& ) = delete;
+   CEventLoop( CEventLoop&& ) = delete;
+   ~CEventLoop();
+
+   CEventLoop& operator=( const CEventLoop& ) = delete;
+   CEventLoop& operator=( CEventLoop&& ) = delete;
+
+   /// Start watching a socket, which should be non-blocking.
+   /// @return false if the socket could not be added, the reason is set on the socket.
+   bool Register( CSimpleSocket& socket, uint32_t nEvents, CHandler handler );
+
+   /// Change the events a registered socket is watched for.
+   /// @return false if the socket is not registered or epoll refused the change.
+   bool Modify( CSimpleSocket& socket, uint32_t nEvents );
+
+   /// Stop watching a socket. Safe to call from within a handler, including its own.
+   bool Unregister( CSimpleSocket& socket );
+
+   /// Wait once for readiness and dispatch every ready handler.
+   /// @param nTimeoutMs milliseconds to wait, -1 blocks until an event or Stop().
+   /// @return number of handlers invoked, or -1 if the wait failed.
+   int32_t RunOnce( int32_t nTimeoutMs = -1 );
+
+   /// Dispatch events until Stop() is called.
+   void Run();
+
+   /// Wake up the loop and make Run() return. May be called from any thread.
+   void Stop();
+
+   [[nodiscard]] size_t GetRegisteredCount() const { return m_registrations.size(); }
+
+private:
+   struct CRegistration
+   {
+      CSimpleSocket* pSocket;
+      CHandler handler;
+      uint32_t nGeneration;   /// tells apart registrations which reuse a closed handle
+   };
+
+   /// Event data naming a registration, the handle alone may already belong to a newer one.
+   static uint64_t EventData( SOCKET socket, uint32_t nGeneration )
+   {
+      return ( static_cast<uint64_t>( nGeneration ) << 32 ) | static_cast<uint32_t>( socket );
+   }
+
+   int m_epoll = -1;                                                              /// epoll instance
+   int m_wakeup = -1;                                                             /// eventfd used by Stop()
+   std::atomic<bool> m_bStopRequested{ false };                                   /// set by Stop()
+   bool m_bDispatching = false;                                                   /// inside RunOnce's dispatch
+   uint32_t m_nNextGeneration = 1;                                                /// 0 is the wakeup event
+   std::vector<epoll_event> m_events;                                             /// kernel output buffer
+   std::unordered_map<SOCKET, std::unique_ptr<CRegistration>> m_registrations;   /// sockets being watched
+   std::vector<std::unique_ptr<CRegistration>> m_retired;   /// unregistered while dispatching
+};
+
+#endif   // _LINUX
+
+#endif   // __EVENTLOOP_H__
@@ -45,6 +45,7 @@
    #define RECV(a,b,c,d)          recv(a, (char *)b, c, d)
    #define RECVFROM(a,b,c,d,e,f)  recvfrom(a, (char *)b, c, d, (sockaddr *)e, (int *)f)
    #define RECV_FLAGS             MSG_WAITALL
+   #define POLL(a,b,c)            WSAPoll(a,b,c)
    #define SELECT(a,b,c,d,e)      select((int32_t)a,b,c,d,e)
    #define SEND(a,b,c,d)          send(a, (const char *)b, (int)c, d)
    #define SENDTO(a,b,c,d,e,f)    sendto(a, (const char *)b, (int)c, d, e, f)
@@ -70,10 +71,13 @@
    #define SEEK(a,b,c)            lseek(a,b,c)
    #define RECV(a,b,c,d)          recv(a, (void *)b, c, d)
    #define RECVFROM(a,b,c,d,e,f)  recvfrom(a, (char *)b, c, d, (sockaddr *)e, f)
+   #define RECVMSG(a,b,c)         recvmsg(a,b,c)
    #define RECV_FLAGS             MSG_WAITALL
+   #define POLL(a,b,c)            poll(a,b,c)
    #define SELECT(a,b,c,d,e)      select(a,b,c,d,e)
    #define SEND(a,b,c,d)          send(a, (const char *)b, c, d)
    #define SENDTO(a,b,c,d,e,f)    sendto(a, (const char *)b, c, d, e, f)
+   #define SENDMSG(a,b,c)         sendmsg(a,b,c)
    #define SEND_FLAGS             0
    #define SENDFILE(a,b,c,d)      sendfile(a, b, c, d)
    #define SET_SOCKET_ERROR(x,y)  errno=y
@@ -0,0 +1,930 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "IoUring.h"
+
+#include <algorithm>
+
+#ifdef IO_URING
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+static constexpr uint16_t POOL_BUFFER_GROUP = 1;
+static constexpr uint32_t FIXED_FILE_SLOTS = 1024;
+static constexpr uint64_t INTERNAL_TOKEN = 0;   // Completions the caller does not need to see
+
+CIoUring::CIoUring( uint32_t nEntries, CMode nMode )
+{
+#ifdef IO_URING
+   if ( nMode == ModeAutomatic && !SetupRing( nEntries ) )
+   {
+      Teardown();   // Release any partial mapping, the fallback is used from here on
+   }
+#else
+   (void)nEntries;
+   (void)nMode;
+#endif
+}
+
+CIoUring::~CIoUring() { Teardown(); }
+
+void CIoUring::Teardown()
+{
+#ifdef IO_URING
+   if ( m_pSqes != nullptr ) munmap( m_pSqes, m_nSqesSize );
+   if ( m_pCqRing != nullptr && m_pCqRing != m_pSqRing ) munmap( m_pCqRing, m_nCqRingSize );
+   if ( m_pSqRing != nullptr ) munmap( m_pSqRing, m_nSqRingSize );
+   if ( IsAvailable() ) CLOSE( m_ring );
+
+   m_ring = INVALID_SOCKET;
+   m_pSqes = nullptr;
+   m_pCqRing = nullptr;
+   m_pSqRing = nullptr;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Queue() - Prepare a request for the ring or keep it for the synchronous fallback
+//
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::Queue( CRequest request )
+{
+   if ( !request.pSocket->IsSocketValid() )
+   {
+      request.pSocket->SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   const uint64_t nToken = m_nNextToken++;
+   CRequest& queued = m_requests.emplace( nToken, std::move( request ) ).first->second;
+
+#ifdef IO_URING
+   // Datagram sockets need an address per request which the single buffer opcodes do not carry.
+   if ( IsAvailable() && queued.pSocket->GetSocketType() == CSimpleSocket::SocketTypeTcp )
+   {
+      if ( !PrepareRequest( nToken, queued ) )
+      {
+         m_requests.erase( nToken );
+         return false;
+      }
+
+      queued.bSubmitted = true;
+   }
+#else
+   (void)queued;
+#endif
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::Accept( CPassiveSocket& socket, uint64_t nTag, bool bMultishot )
+{
+   if ( socket.GetSocketType() != CSimpleSocket::SocketTypeTcp )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketProtocolError );
+      return false;
+   }
+
+   CRequest request{ OperationAccept, &socket, nTag };
+   request.bMultishot = bMultishot && m_bMultishot;
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::Open( CActiveSocket& socket, const char* pAddr, uint16_t nPort, uint64_t nTag )
+{
+   if ( !socket.Validate( pAddr, nPort ) )
+   {
+      return false;
+   }
+
+   CRequest request{ OperationConnect, &socket, nTag };
+   request.sHost = pAddr;
+   request.nPort = nPort;
+
+   if ( IsAvailable() && socket.GetSocketType() == CSimpleSocket::SocketTypeTcp )
+   {
+      // Resolve now so the kernel has an address to connect to
+      if ( !socket.PreConnect( pAddr, nPort ) )
+      {
+         return false;
+      }
+
+      request.stAddr = socket.m_stServerSockaddr;
+   }
+
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::Send( CSimpleSocket& socket, const uint8_t* pBuf, size_t bytesToSend, uint64_t nTag )
+{
+   if ( bytesToSend == 0 || pBuf == nullptr )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidPointer );
+      return false;
+   }
+
+   CRequest request{ OperationSend, &socket, nTag };
+   request.pBuffer = const_cast<uint8_t*>( pBuf );
+   request.nLength = static_cast<uint32_t>( bytesToSend );
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::Receive( CSimpleSocket& socket, uint8_t* pBuffer, uint32_t nMaxBytes, uint64_t nTag )
+{
+   if ( nMaxBytes == 0 || pBuffer == nullptr )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidPointer );
+      return false;
+   }
+
+   CRequest request{ OperationReceive, &socket, nTag };
+   request.pBuffer = pBuffer;
+   request.nLength = nMaxBytes;
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::SendRegistered( CSimpleSocket& socket, uint32_t nIndex, uint32_t nOffset, uint32_t nLength,
+                               uint64_t nTag )
+{
+   if ( nIndex >= m_registeredBuffers.size() || nLength == 0 ||
+        nOffset + nLength > m_registeredBuffers[ nIndex ].iov_len )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidPointer );
+      return false;
+   }
+
+   CRequest request{ OperationSend, &socket, nTag };
+   request.pBuffer = static_cast<uint8_t*>( m_registeredBuffers[ nIndex ].iov_base ) + nOffset;
+   request.nLength = nLength;
+   request.nBufferIndex = static_cast<int32_t>( nIndex );
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::ReceiveRegistered( CSimpleSocket& socket, uint32_t nIndex, uint32_t nOffset, uint32_t nLength,
+                                  uint64_t nTag )
+{
+   if ( nIndex >= m_registeredBuffers.size() || nLength == 0 ||
+        nOffset + nLength > m_registeredBuffers[ nIndex ].iov_len )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidPointer );
+      return false;
+   }
+
+   CRequest request{ OperationReceive, &socket, nTag };
+   request.pBuffer = static_cast<uint8_t*>( m_registeredBuffers[ nIndex ].iov_base ) + nOffset;
+   request.nLength = nLength;
+   request.nBufferIndex = static_cast<int32_t>( nIndex );
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::ReceivePooled( CSimpleSocket& socket, uint64_t nTag, bool bMultishot )
+{
+   if ( m_pPoolBase == nullptr )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidPointer );
+      return false;
+   }
+
+   CRequest request{ OperationReceive, &socket, nTag };
+   request.nLength = m_nPoolBufferSize;
+   request.bMultishot = bMultishot && m_bMultishot;
+   request.bPooled = true;
+   return Queue( std::move( request ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Register Resources
+//
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::RegisterSocket( CSimpleSocket& socket )
+{
+   if ( !socket.IsSocketValid() )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   if ( !IsAvailable() || m_fixedFiles.count( socket.m_socket ) != 0 )
+   {
+      return true;   // Nothing to gain without a ring
+   }
+
+#ifdef IO_URING
+   errno = CSimpleSocket::SocketSuccess;
+
+   if ( m_fileTable.empty() )
+   {
+      m_fileTable.assign( FIXED_FILE_SLOTS, INVALID_SOCKET );
+      if ( Register( IORING_REGISTER_FILES, m_fileTable.data(), FIXED_FILE_SLOTS ) == CSimpleSocket::SocketError )
+      {
+         m_fileTable.clear();
+         socket.TranslateSocketError();
+         return false;
+      }
+   }
+
+   int32_t nSlot = 0;
+   while ( nSlot < static_cast<int32_t>( m_fileTable.size() ) && m_fileTable[ nSlot ] != INVALID_SOCKET )
+   {
+      ++nSlot;
+   }
+
+   if ( nSlot == static_cast<int32_t>( m_fileTable.size() ) )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidOperation );
+      return false;
+   }
+
+   io_uring_files_update stUpdate{};
+   stUpdate.offset = static_cast<uint32_t>( nSlot );
+   stUpdate.fds = reinterpret_cast<uint64_t>( &socket.m_socket );
+
+   const bool bRetVal = ( Register( IORING_REGISTER_FILES_UPDATE, &stUpdate, 1 ) != CSimpleSocket::SocketError );
+   socket.TranslateSocketError();
+
+   if ( bRetVal )
+   {
+      m_fileTable[ nSlot ] = socket.m_socket;
+      m_fixedFiles.emplace( socket.m_socket, nSlot );
+   }
+
+   return bRetVal;
+#else
+   return true;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::UnregisterSocket( CSimpleSocket& socket )
+{
+   const auto itor = m_fixedFiles.find( socket.m_socket );
+   if ( itor == m_fixedFiles.end() )
+   {
+      return true;
+   }
+
+#ifdef IO_URING
+   const SOCKET nRemoved = INVALID_SOCKET;
+   io_uring_files_update stUpdate{};
+   stUpdate.offset = static_cast<uint32_t>( itor->second );
+   stUpdate.fds = reinterpret_cast<uint64_t>( &nRemoved );
+
+   errno = CSimpleSocket::SocketSuccess;
+   const bool bRetVal = ( Register( IORING_REGISTER_FILES_UPDATE, &stUpdate, 1 ) != CSimpleSocket::SocketError );
+   socket.TranslateSocketError();
+
+   m_fileTable[ itor->second ] = INVALID_SOCKET;
+   m_fixedFiles.erase( itor );
+
+   return bRetVal;
+#else
+   m_fixedFiles.erase( itor );
+   return true;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::RegisterBuffers( const iovec* pBuffers, uint32_t nCount )
+{
+   if ( pBuffers == nullptr || nCount == 0 )
+   {
+      return false;
+   }
+
+#ifdef IO_URING
+   if ( IsAvailable() )
+   {
+      if ( !m_registeredBuffers.empty() ) Register( IORING_UNREGISTER_BUFFERS, nullptr, 0 );
+      m_registeredBuffers.clear();
+
+      if ( Register( IORING_REGISTER_BUFFERS, pBuffers, nCount ) == CSimpleSocket::SocketError )
+      {
+         return false;
+      }
+   }
+#endif
+
+   m_registeredBuffers.assign( pBuffers, pBuffers + nCount );
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::ProvideBuffers( uint8_t* pBase, uint32_t nBufferSize, uint16_t nCount )
+{
+   if ( pBase == nullptr || nBufferSize == 0 || nCount == 0 )
+   {
+      return false;
+   }
+
+   m_pPoolBase = pBase;
+   m_nPoolBufferSize = nBufferSize;
+   m_freePoolBuffers.clear();
+
+   for ( int32_t nId = nCount - 1; nId >= 0; --nId )
+   {
+      m_freePoolBuffers.push_back( nId );
+   }
+
+#ifdef IO_URING
+   if ( IsAvailable() )
+   {
+      io_uring_sqe* pSqe = GetSqe();
+      if ( pSqe == nullptr )
+      {
+         return false;
+      }
+
+      pSqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+      pSqe->fd = nCount;
+      pSqe->addr = reinterpret_cast<uint64_t>( pBase );
+      pSqe->len = nBufferSize;
+      pSqe->off = 0;
+      pSqe->buf_group = POOL_BUFFER_GROUP;
+      pSqe->user_data = INTERNAL_TOKEN;
+
+      return Submit() != CSimpleSocket::SocketError;
+   }
+#endif
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::RecycleBuffer( int32_t nBufferId )
+{
+   if ( m_pPoolBase == nullptr || nBufferId < 0 )
+   {
+      return false;
+   }
+
+#ifdef IO_URING
+   if ( IsAvailable() )
+   {
+      io_uring_sqe* pSqe = GetSqe();
+      if ( pSqe == nullptr )
+      {
+         return false;
+      }
+
+      // Rides along with the next submission
+      pSqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+      pSqe->fd = 1;
+      pSqe->addr = reinterpret_cast<uint64_t>( m_pPoolBase + static_cast<size_t>( nBufferId ) * m_nPoolBufferSize );
+      pSqe->len = m_nPoolBufferSize;
+      pSqe->off = static_cast<uint64_t>( nBufferId );
+      pSqe->buf_group = POOL_BUFFER_GROUP;
+      pSqe->user_data = INTERNAL_TOKEN;
+
+      return true;
+   }
+#endif
+
+   m_freePoolBuffers.push_back( nBufferId );
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Submit()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CIoUring::Submit()
+{
+#ifdef IO_URING
+   if ( IsAvailable() && m_nUnsubmitted > 0 )
+   {
+      const int32_t nSubmitted = Enter( m_nUnsubmitted, 0, -1 );
+      return nSubmitted;
+   }
+#endif
+
+   return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// WaitCompletions()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CIoUring::WaitCompletions( std::vector<CCompletion>& completions, uint32_t nMinimum, int32_t nTimeoutMs )
+{
+   const size_t nInitial = completions.size();
+
+   // Requests the ring can not carry, or every request when there is no ring, run now in order.
+   std::vector<uint64_t> synchronous;
+   for ( const auto& request : m_requests )
+   {
+      if ( !request.second.bSubmitted ) synchronous.push_back( request.first );
+   }
+
+   std::sort( synchronous.begin(), synchronous.end() );
+   for ( const uint64_t nToken : synchronous )
+   {
+      RunSynchronously( m_requests.at( nToken ), completions );
+      m_requests.erase( nToken );
+   }
+
+#ifdef IO_URING
+   if ( IsAvailable() )
+   {
+      uint32_t nReaped = Reap( completions );
+      const uint32_t nWanted = nMinimum > nReaped ? nMinimum - nReaped : 0;
+
+      if ( nWanted > 0 || m_nUnsubmitted > 0 )
+      {
+         if ( Enter( m_nUnsubmitted, nWanted, nTimeoutMs ) == CSimpleSocket::SocketError && errno != ETIME &&
+              errno != EINTR )
+         {
+            return CSimpleSocket::SocketError;
+         }
+
+         nReaped += Reap( completions );
+      }
+
+      if ( m_nInternalError != 0 )
+      {
+         errno = m_nInternalError;
+         m_nInternalError = 0;
+         return CSimpleSocket::SocketError;
+      }
+   }
+#else
+   (void)nMinimum;
+   (void)nTimeoutMs;
+#endif
+
+   return static_cast<int32_t>( completions.size() - nInitial );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Complete() - Apply the result of a request to its socket
+//
+//-------------------------------------------------------------------------------------------------
+void CIoUring::Complete( CRequest& request, int32_t nResult, uint32_t nFlags, CCompletion& completion )
+{
+   CSimpleSocket& socket = *request.pSocket;
+
+   completion.nTag = request.nTag;
+   completion.nOperation = request.nOperation;
+   completion.pSocket = &socket;
+
+   if ( nResult < 0 )
+   {
+      errno = -nResult;
+      socket.TranslateSocketError();
+      completion.nResult = CSimpleSocket::SocketError;
+   }
+   else
+   {
+      socket.SetSocketError( CSimpleSocket::SocketSuccess );
+      completion.nResult = nResult;
+   }
+
+   switch ( request.nOperation )
+   {
+   case OperationAccept:
+      if ( nResult >= 0 )
+      {
+         socklen_t nSockAddrLen = CSimpleSocket::SOCKET_ADDR_IN_SIZE;
+         completion.pAccepted = std::make_unique<CActiveSocket>( nResult, CSimpleSocket::SocketTypeTcp );
+         CSimpleSocket& accepted = *completion.pAccepted;
+
+         // Multishot accepts can not report the peer, ask for it instead.
+         if ( request.bMultishot )
+            GETPEERNAME( nResult, &accepted.m_stClientSockaddr, &nSockAddrLen );
+         else
+            accepted.m_stClientSockaddr = request.stAddr;
+
+         nSockAddrLen = CSimpleSocket::SOCKET_ADDR_IN_SIZE;
+         GETSOCKNAME( nResult, &accepted.m_stServerSockaddr, &nSockAddrLen );
+         socket.m_stClientSockaddr = accepted.m_stClientSockaddr;
+      }
+      break;
+
+   case OperationConnect:
+      if ( nResult >= 0 )
+      {
+         socklen_t nSockLen = CSimpleSocket::SOCKET_ADDR_IN_SIZE;
+         memset( &socket.m_stClientSockaddr, 0, CSimpleSocket::SOCKET_ADDR_IN_SIZE );
+         GETSOCKNAME( socket.m_socket, &socket.m_stClientSockaddr, &nSockLen );
+      }
+      break;
+
+   case OperationSend:
+      socket.m_nBytesSent = completion.nResult;
+      break;
+
+   case OperationReceive:
+      socket.m_nBytesReceived = completion.nResult;
+#ifdef IO_URING
+      if ( nFlags & IORING_CQE_F_BUFFER )
+      {
+         completion.nBufferId = static_cast<int32_t>( nFlags >> IORING_CQE_BUFFER_SHIFT );
+         completion.pData = m_pPoolBase + static_cast<size_t>( completion.nBufferId ) * m_nPoolBufferSize;
+      }
+#else
+      (void)nFlags;
+#endif
+      break;
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// RunSynchronously() - The regular blocking path for when the ring can not be used
+//
+//-------------------------------------------------------------------------------------------------
+void CIoUring::RunSynchronously( CRequest& request, std::vector<CCompletion>& completions )
+{
+   CCompletion completion;
+   completion.nTag = request.nTag;
+   completion.nOperation = request.nOperation;
+   completion.pSocket = request.pSocket;
+
+   switch ( request.nOperation )
+   {
+   case OperationAccept:
+      completion.pAccepted = static_cast<CPassiveSocket*>( request.pSocket )->Accept();
+      completion.nResult = completion.pAccepted ? completion.pAccepted->m_socket : CSimpleSocket::SocketError;
+      break;
+
+   case OperationConnect:
+      completion.nResult = static_cast<CActiveSocket*>( request.pSocket )->Open( request.sHost.c_str(), request.nPort )
+                               ? CSimpleSocket::SocketSuccess
+                               : CSimpleSocket::SocketError;
+      break;
+
+   case OperationSend:
+      completion.nResult = request.pSocket->Send( request.pBuffer, request.nLength );
+      break;
+
+   case OperationReceive:
+      if ( request.bPooled )
+      {
+         if ( m_freePoolBuffers.empty() )
+         {
+            request.pSocket->SetSocketError( CSimpleSocket::SocketInvalidSocketBuffer );
+            completion.nResult = CSimpleSocket::SocketError;
+            break;
+         }
+
+         completion.nBufferId = m_freePoolBuffers.back();
+         m_freePoolBuffers.pop_back();
+         request.pBuffer = m_pPoolBase + static_cast<size_t>( completion.nBufferId ) * m_nPoolBufferSize;
+      }
+
+      completion.nResult = request.pSocket->Receive( request.nLength, request.pBuffer );
+
+      if ( request.bPooled && completion.nResult <= 0 )
+      {
+         m_freePoolBuffers.push_back( completion.nBufferId );
+         completion.nBufferId = -1;
+      }
+      else if ( request.bPooled )
+      {
+         completion.pData = request.pBuffer;
+      }
+      break;
+   }
+
+   completions.emplace_back( std::move( completion ) );
+}
+
+#ifdef IO_URING
+//-------------------------------------------------------------------------------------------------
+//
+// SetupRing() - Create the ring and map its queues
+//
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::SetupRing( uint32_t nEntries )
+{
+   io_uring_params stParams{};
+   const int nRing = static_cast<int>( syscall( __NR_io_uring_setup, nEntries, &stParams ) );
+   if ( nRing < 0 )
+   {
+      return false;
+   }
+
+   m_ring = nRing;
+   m_bExtArg = ( stParams.features & IORING_FEAT_EXT_ARG ) != 0;
+
+   m_nSqRingSize = stParams.sq_off.array + stParams.sq_entries * sizeof( uint32_t );
+   m_nCqRingSize = stParams.cq_off.cqes + stParams.cq_entries * sizeof( io_uring_cqe );
+
+   const bool bSingleMap = ( stParams.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+   if ( bSingleMap )
+   {
+      m_nSqRingSize = m_nCqRingSize = std::max( m_nSqRingSize, m_nCqRingSize );
+   }
+
+   m_pSqRing = mmap( nullptr, m_nSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring,
+                     IORING_OFF_SQ_RING );
+   if ( m_pSqRing == MAP_FAILED )
+   {
+      m_pSqRing = nullptr;
+      return false;
+   }
+
+   m_pCqRing = bSingleMap ? m_pSqRing
+                          : mmap( nullptr, m_nCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring,
+                                  IORING_OFF_CQ_RING );
+   if ( m_pCqRing == MAP_FAILED )
+   {
+      m_pCqRing = nullptr;
+      return false;
+   }
+
+   m_nSqesSize = stParams.sq_entries * sizeof( io_uring_sqe );
+   void* pSqes =
+       mmap( nullptr, m_nSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES );
+   if ( pSqes == MAP_FAILED )
+   {
+      return false;
+   }
+
+   auto* pSq = static_cast<uint8_t*>( m_pSqRing );
+   auto* pCq = static_cast<uint8_t*>( m_pCqRing );
+
+   m_pSqes = static_cast<io_uring_sqe*>( pSqes );
+   m_pSqHead = reinterpret_cast<uint32_t*>( pSq + stParams.sq_off.head );
+   m_pSqTail = reinterpret_cast<uint32_t*>( pSq + stParams.sq_off.tail );
+   m_pSqArray = reinterpret_cast<uint32_t*>( pSq + stParams.sq_off.array );
+   m_nSqMask = *reinterpret_cast<uint32_t*>( pSq + stParams.sq_off.ring_mask );
+   m_nSqEntries = stParams.sq_entries;
+
+   m_pCqHead = reinterpret_cast<uint32_t*>( pCq + stParams.cq_off.head );
+   m_pCqTail = reinterpret_cast<uint32_t*>( pCq + stParams.cq_off.tail );
+   m_pCqes = reinterpret_cast<io_uring_cqe*>( pCq + stParams.cq_off.cqes );
+   m_nCqMask = *reinterpret_cast<uint32_t*>( pCq + stParams.cq_off.ring_mask );
+
+   m_bMultishot = ProbeMultishot();
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// ProbeMultishot() - Ask the ring which opcodes it knows
+//
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::ProbeMultishot()
+{
+#if defined( IORING_ACCEPT_MULTISHOT ) && defined( IORING_RECV_MULTISHOT )
+   // The flags are not listed by the probe. Zero copy send shipped in the same release as multishot
+   // receive so it stands in for them, Reap() drops back to single shot if the kernel disagrees.
+   std::vector<uint8_t> probe( sizeof( io_uring_probe ) + IORING_OP_LAST * sizeof( io_uring_probe_op ) );
+   auto* pProbe = reinterpret_cast<io_uring_probe*>( probe.data() );
+
+   if ( Register( IORING_REGISTER_PROBE, pProbe, IORING_OP_LAST ) < 0 || pProbe->last_op < IORING_OP_SEND_ZC )
+   {
+      return false;
+   }
+
+   return ( pProbe->ops[ IORING_OP_SEND_ZC ].flags & IO_URING_OP_SUPPORTED ) != 0;
+#else
+   return false;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+io_uring_sqe* CIoUring::GetSqe()
+{
+   uint32_t nTail = *m_pSqTail;
+   if ( nTail - __atomic_load_n( m_pSqHead, __ATOMIC_ACQUIRE ) >= m_nSqEntries )
+   {
+      // Full, hand what we have to the kernel to make room.
+      if ( Submit() == CSimpleSocket::SocketError )
+      {
+         return nullptr;
+      }
+
+      nTail = *m_pSqTail;
+      if ( nTail - __atomic_load_n( m_pSqHead, __ATOMIC_ACQUIRE ) >= m_nSqEntries )
+      {
+         return nullptr;
+      }
+   }
+
+   const uint32_t nIndex = nTail & m_nSqMask;
+   io_uring_sqe* pSqe = &m_pSqes[ nIndex ];
+   memset( pSqe, 0, sizeof( io_uring_sqe ) );
+
+   m_pSqArray[ nIndex ] = nIndex;
+   __atomic_store_n( m_pSqTail, nTail + 1, __ATOMIC_RELEASE );
+   ++m_nUnsubmitted;
+
+   return pSqe;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CIoUring::PrepareRequest( uint64_t nToken, CRequest& request )
+{
+   io_uring_sqe* pSqe = GetSqe();
+   if ( pSqe == nullptr )
+   {
+      request.pSocket->SetSocketError( CSimpleSocket::SocketEwouldblock );
+      return false;
+   }
+
+   const auto itor = m_fixedFiles.find( request.pSocket->m_socket );
+   if ( itor != m_fixedFiles.end() )
+   {
+      pSqe->fd = itor->second;
+      pSqe->flags |= IOSQE_FIXED_FILE;
+   }
+   else
+   {
+      pSqe->fd = request.pSocket->m_socket;
+   }
+
+   pSqe->user_data = nToken;
+
+   switch ( request.nOperation )
+   {
+   case OperationAccept:
+      pSqe->opcode = IORING_OP_ACCEPT;
+#ifdef IORING_ACCEPT_MULTISHOT
+      if ( request.bMultishot )
+      {
+         pSqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+         break;
+      }
+#endif
+      pSqe->addr = reinterpret_cast<uint64_t>( &request.stAddr );
+      pSqe->addr2 = reinterpret_cast<uint64_t>( &request.nAddrLen );
+      break;
+
+   case OperationConnect:
+      pSqe->opcode = IORING_OP_CONNECT;
+      pSqe->addr = reinterpret_cast<uint64_t>( &request.stAddr );
+      pSqe->off = request.nAddrLen;
+      break;
+
+   case OperationSend:
+   case OperationReceive:
+      pSqe->len = request.nLength;
+
+      if ( request.bPooled )
+      {
+         pSqe->opcode = IORING_OP_RECV;
+         pSqe->flags |= IOSQE_BUFFER_SELECT;
+         pSqe->buf_group = POOL_BUFFER_GROUP;
+#ifdef IORING_RECV_MULTISHOT
+         if ( request.bMultishot )
+         {
+            pSqe->ioprio |= IORING_RECV_MULTISHOT;
+            pSqe->len = 0;   // Whole buffer
+         }
+#endif
+      }
+      else if ( request.nBufferIndex >= 0 )
+      {
+         // Registered buffer, sockets are streams so the file position is ignored.
+         pSqe->opcode = request.nOperation == OperationSend ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+         pSqe->addr = reinterpret_cast<uint64_t>( request.pBuffer );
+         pSqe->off = static_cast<uint64_t>( -1 );
+         pSqe->buf_index = static_cast<uint16_t>( request.nBufferIndex );
+      }
+      else
+      {
+         pSqe->opcode = request.nOperation == OperationSend ? IORING_OP_SEND : IORING_OP_RECV;
+         pSqe->addr = reinterpret_cast<uint64_t>( request.pBuffer );
+      }
+      break;
+   }
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CIoUring::Enter( uint32_t nSubmit, uint32_t nWait, int32_t nTimeoutMs )
+{
+   uint32_t nFlags = nWait > 0 ? IORING_ENTER_GETEVENTS : 0;
+   long nResult = 0;
+
+   if ( nWait > 0 && nTimeoutMs >= 0 && m_bExtArg )
+   {
+      __kernel_timespec stTimeout{ nTimeoutMs / 1000, ( nTimeoutMs % 1000 ) * 1000000LL };
+      io_uring_getevents_arg stArg{};
+      stArg.sigmask_sz = _NSIG / 8;
+      stArg.ts = reinterpret_cast<uint64_t>( &stTimeout );
+
+      nFlags |= IORING_ENTER_EXT_ARG;
+      nResult = syscall( __NR_io_uring_enter, m_ring, nSubmit, nWait, nFlags, &stArg, sizeof( stArg ) );
+   }
+   else
+   {
+      // Without a timeout facility never block for longer than asked.
+      if ( nTimeoutMs >= 0 && !m_bExtArg )
+      {
+         nWait = 0;
+         nFlags = 0;
+      }
+
+      nResult = syscall( __NR_io_uring_enter, m_ring, nSubmit, nWait, nFlags, nullptr, _NSIG / 8 );
+   }
+
+   if ( nResult >= 0 )
+   {
+      m_nUnsubmitted -= std::min( m_nUnsubmitted, static_cast<uint32_t>( nResult ) );
+   }
+
+   return static_cast<int32_t>( nResult );
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CIoUring::Register( uint32_t nOpcode, const void* pArg, uint32_t nArgs )
+{
+   return static_cast<int32_t>( syscall( __NR_io_uring_register, m_ring, nOpcode, pArg, nArgs ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t CIoUring::Reap( std::vector<CCompletion>& completions )
+{
+   uint32_t nHead = *m_pCqHead;
+   const uint32_t nTail = __atomic_load_n( m_pCqTail, __ATOMIC_ACQUIRE );
+   uint32_t nReaped = 0;
+
+   for ( ; nHead != nTail; ++nHead )
+   {
+      const io_uring_cqe& stCqe = m_pCqes[ nHead & m_nCqMask ];
+      if ( stCqe.user_data == INTERNAL_TOKEN )
+      {
+         if ( stCqe.res < 0 )
+         {
+            m_nInternalError = -stCqe.res;
+         }
+         continue;
+      }
+
+      const auto itor = m_requests.find( stCqe.user_data );
+      if ( itor == m_requests.end() )
+      {
+         continue;
+      }
+
+      // A kernel without multishot support refuses the flag, ask again for a single completion.
+      CRequest& request = itor->second;
+      if ( request.bMultishot && stCqe.res == -EINVAL )
+      {
+         m_bMultishot = false;
+         request.bMultishot = false;
+         if ( PrepareRequest( stCqe.user_data, request ) )
+         {
+            continue;
+         }
+      }
+
+      CCompletion completion;
+      Complete( request, stCqe.res, stCqe.flags, completion );
+      completion.bMore = ( stCqe.flags & IORING_CQE_F_MORE ) != 0;
+      completions.emplace_back( std::move( completion ) );
+      ++nReaped;
+
+      if ( !completions.back().bMore )
+      {
+         m_requests.erase( itor );
+      }
+   }
+
+   __atomic_store_n( m_pCqHead, nHead, __ATOMIC_RELEASE );
+
+   return nReaped;
+}
+#endif   // IO_URING
@@ -0,0 +1,205 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __IOURING_H__
+#define __IOURING_H__
+
+#include "PassiveSocket.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/// Queues Accept, Open, Send and Receive requests and submits them to the kernel in
+/// batches through an io_uring instance. When io_uring is not available, either
+/// because the library was built without it or the kernel refuses to create a ring,
+/// the queued requests are carried out with the regular calls by WaitCompletions().
+/// Sockets and buffers must outlive the requests referring to them.
+class CIoUring
+{
+public:
+   /// How queued requests are carried out.
+   enum CMode
+   {
+      ModeAutomatic,   ///< Use io_uring when possible, otherwise fallback.
+      ModeSynchronous  ///< Always use the regular socket calls.
+   };
+
+   /// Type of request a completion belongs to.
+   enum COperation
+   {
+      OperationAccept,
+      OperationConnect,
+      OperationSend,
+      OperationReceive
+   };
+
+   /// Outcome of a request. The socket's error and byte counters are updated as if the
+   /// equivalent CSimpleSocket call had been made.
+   struct CCompletion
+   {
+      uint64_t nTag = 0;                             ///< Value given when the request was queued.
+      COperation nOperation = OperationSend;         ///< Request type.
+      CSimpleSocket* pSocket = nullptr;              ///< Socket the request was made on.
+      int32_t nResult = CSimpleSocket::SocketError;  ///< Bytes transferred, or -1 on error.
+      bool bMore = false;                            ///< A multishot request is still armed.
+      const uint8_t* pData = nullptr;                ///< Data of a pooled receive, see RecycleBuffer().
+      int32_t nBufferId = -1;                        ///< Pool buffer holding the data of a pooled receive.
+      std::unique_ptr<CActiveSocket> pAccepted;      ///< New connection of an accept.
+   };
+
+   explicit CIoUring( uint32_t nEntries = 256, CMode nMode = ModeAutomatic );
+   CIoUring( const CIoUring& ) = delete;
+   CIoUring( CIoUring&& ) = delete;
+   ~CIoUring();
+
+   CIoUring& operator=( const CIoUring& ) = delete;
+   CIoUring& operator=( CIoUring&& ) = delete;
+
+   /// @return true if requests are submitted to the kernel through io_uring.
+   [[nodiscard]] bool IsAvailable() const { return m_ring != INVALID_SOCKET; }
+
+   /// @return true if multishot accept and receive are used rather than emulated.
+   [[nodiscard]] bool SupportsMultishot() const { return m_bMultishot; }
+
+   /// Add a socket to the fixed file table so the kernel can skip the descriptor lookup on
+   /// every request. Must be removed with UnregisterSocket() before the socket is closed.
+   bool RegisterSocket( CSimpleSocket& socket );
+   bool UnregisterSocket( CSimpleSocket& socket );
+
+   /// Pin caller owned memory once so SendRegistered() and ReceiveRegistered() do not
+   /// need to map the pages on every request. Replaces any previous registration.
+   bool RegisterBuffers( const iovec* pBuffers, uint32_t nCount );
+
+   /// Hand the kernel a pool of nCount buffers of nBufferSize bytes each, carved from pBase,
+   /// which pooled receives select from as data arrives.
+   bool ProvideBuffers( uint8_t* pBase, uint32_t nBufferSize, uint16_t nCount );
+
+   /// Give a buffer reported by a pooled receive back to the pool.
+   bool RecycleBuffer( int32_t nBufferId );
+
+   bool Accept( CPassiveSocket& socket, uint64_t nTag, bool bMultishot = false );
+   bool Open( CActiveSocket& socket, const char* pAddr, uint16_t nPort, uint64_t nTag );
+   bool Send( CSimpleSocket& socket, const uint8_t* pBuf, size_t bytesToSend, uint64_t nTag );
+   bool Receive( CSimpleSocket& socket, uint8_t* pBuffer, uint32_t nMaxBytes, uint64_t nTag );
+
+   /// Send from, or receive into, a slice of a buffer given to RegisterBuffers().
+   bool SendRegistered( CSimpleSocket& socket, uint32_t nIndex, uint32_t nOffset, uint32_t nLength, uint64_t nTag );
+   bool ReceiveRegistered( CSimpleSocket& socket, uint32_t nIndex, uint32_t nOffset, uint32_t nLength, uint64_t nTag );
+
+   /// Receive into whichever pool buffer is free, see ProvideBuffers().
+   bool ReceivePooled( CSimpleSocket& socket, uint64_t nTag, bool bMultishot = false );
+
+   /// Pass every queued request to the kernel with a single system call. Requests on
+   /// datagram sockets, or all of them without a ring, are left for WaitCompletions().
+   /// @return number of requests submitted, or -1 on error.
+   int32_t Submit();
+
+   /// Submit queued requests then collect their completions.
+   /// @param completions receives the finished requests, it is not cleared.
+   /// @param nMinimum number of completions to wait for.
+   /// @param nTimeoutMs give up waiting after this many milliseconds, -1 waits forever.
+   /// @return number of completions appended, or -1 on error. A ProvideBuffers() or
+   /// RecycleBuffer() the kernel refused is reported here, with errno set to its error.
+   int32_t WaitCompletions( std::vector<CCompletion>& completions, uint32_t nMinimum = 1, int32_t nTimeoutMs = -1 );
+
+   [[nodiscard]] size_t GetPendingCount() const { return m_requests.size(); }
+
+private:
+   struct CRequest
+   {
+      CRequest( COperation nRequestOperation, CSimpleSocket* pRequestSocket, uint64_t nRequestTag )
+          : nOperation( nRequestOperation ), pSocket( pRequestSocket ), nTag( nRequestTag )
+      {
+      }
+
+      COperation nOperation = OperationSend;
+      CSimpleSocket* pSocket = nullptr;
+      uint64_t nTag = 0;
+      uint8_t* pBuffer = nullptr;
+      uint32_t nLength = 0;
+      int32_t nBufferIndex = -1;   /// registered buffer, if any
+      bool bMultishot = false;
+      bool bPooled = false;
+      bool bSubmitted = false;   /// handed to the ring rather than the synchronous fallback
+      sockaddr_in stAddr = {};
+      socklen_t nAddrLen = sizeof( sockaddr_in );
+      std::string sHost;   /// only used by the synchronous fallback
+      uint16_t nPort = 0;
+   };
+
+   void Teardown();
+   bool Queue( CRequest request );
+   void RunSynchronously( CRequest& request, std::vector<CCompletion>& completions );
+   void Complete( CRequest& request, int32_t nResult, uint32_t nFlags, CCompletion& completion );
+
+#ifdef IO_URING
+   bool SetupRing( uint32_t nEntries );
+   bool ProbeMultishot();
+   io_uring_sqe* GetSqe();
+   bool PrepareRequest( uint64_t nToken, CRequest& request );
+   int32_t Enter( uint32_t nSubmit, uint32_t nWait, int32_t nTimeoutMs );
+   int32_t Register( uint32_t nOpcode, const void* pArg, uint32_t nArgs );
+   uint32_t Reap( std::vector<CCompletion>& completions );
+#endif
+
+   SOCKET m_ring = INVALID_SOCKET;   /// io_uring file descriptor
+   bool m_bMultishot = false;        /// kernel supports multishot accept/recv
+   bool m_bExtArg = false;           /// kernel supports timeouts on enter
+   int32_t m_nInternalError = 0;     /// errno of a failed internal request, not yet reported
+
+   void* m_pSqRing = nullptr;   /// submission queue mapping
+   void* m_pCqRing = nullptr;   /// completion queue mapping (may alias m_pSqRing)
+   size_t m_nSqRingSize = 0;
+   size_t m_nCqRingSize = 0;
+   io_uring_sqe* m_pSqes = nullptr;
+   size_t m_nSqesSize = 0;
+   uint32_t* m_pSqHead = nullptr;
+   uint32_t* m_pSqTail = nullptr;
+   uint32_t* m_pSqArray = nullptr;
+   uint32_t m_nSqMask = 0;
+   uint32_t m_nSqEntries = 0;
+   uint32_t* m_pCqHead = nullptr;
+   uint32_t* m_pCqTail = nullptr;
+   io_uring_cqe* m_pCqes = nullptr;
+   uint32_t m_nCqMask = 0;
+   uint32_t m_nUnsubmitted = 0;   /// sqes written but not yet passed to the kernel
+
+   uint64_t m_nNextToken = 1;                              /// identifies requests in flight
+   std::unordered_map<uint64_t, CRequest> m_requests;      /// queued and in flight requests
+   std::unordered_map<SOCKET, int32_t> m_fixedFiles;       /// socket to fixed file slot
+   std::vector<SOCKET> m_fileTable;                        /// fixed file slots
+   std::vector<iovec> m_registeredBuffers;                 /// buffers given to RegisterBuffers()
+   uint8_t* m_pPoolBase = nullptr;                         /// buffers given to ProvideBuffers()
+   uint32_t m_nPoolBufferSize = 0;
+   std::vector<int32_t> m_freePoolBuffers;                 /// synchronous fallback bookkeeping
+};
+
+#endif   // __IOURING_H__
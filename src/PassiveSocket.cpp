@@ -46,6 +46,7 @@
 #ifdef _WIN32
 #include <Ws2tcpip.h>
 #elif defined( _LINUX ) || defined( _DARWIN )
+#include <fcntl.h>
 #include <netinet/ip.h>
 #endif
 
@@ -53,6 +54,11 @@ CPassiveSocket::CPassiveSocket( CSocketType nType ) : CSimpleSocket( nType ) {}
 
 bool CPassiveSocket::Listen( const char* pAddr, uint16_t nPort, int32_t nConnectionBacklog )
 {
+   if ( !EnsureHandle() )
+   {
+      return false;
+   }
+
 #ifdef _LINUX
    //--------------------------------------------------------------------------
    // Set the following socket option SO_REUSEADDR. This will allow the file
@@ -124,7 +130,7 @@ bool CPassiveSocket::Listen( const char* pAddr, uint16_t nPort, int32_t nConnect
    return bRetVal;
 }
 
-auto CPassiveSocket::Accept() -> std::unique_ptr<CActiveSocket>
+auto CPassiveSocket::Accept( CSocketRecycler* pRecycler ) -> std::unique_ptr<CActiveSocket>
 {
    if ( m_nSocketType != CSimpleSocket::SocketTypeTcp )
    {
@@ -132,41 +138,121 @@ auto CPassiveSocket::Accept() -> std::unique_ptr<CActiveSocket>
       return nullptr;
    }
 
-   auto pClientSocket = std::make_unique<CActiveSocket>();
-   CSocketError socketErrno;
-
    m_timer.SetStartTime();
 
-   // do
-   //{
    socklen_t nSockAddrLen( SOCKET_ADDR_IN_SIZE );
    const SOCKET socket = ACCEPT( m_socket, &m_stClientSockaddr, &nSockAddrLen );   // Wait for incoming connection.
 
-   if ( socket != INVALID_SOCKET )
+   m_timer.SetEndTime();
+
+   if ( socket == INVALID_SOCKET )
    {
-      pClientSocket->SetSocketHandle( socket );
-      pClientSocket->TranslateSocketError();
-      socketErrno = pClientSocket->GetSocketError();
+      TranslateSocketError();
+      return nullptr;
+   }
 
-      // Store client and server IP and port information for this connection.
-      GETPEERNAME( m_socket, &pClientSocket->m_stClientSockaddr, &nSockAddrLen );
-      memcpy( &pClientSocket->m_stClientSockaddr, &m_stClientSockaddr, SOCKET_ADDR_IN_SIZE );
+   SetSocketError( CSimpleSocket::SocketSuccess );
+   return Adopt( socket, m_stClientSockaddr, pRecycler );
+}
 
-      GETSOCKNAME( m_socket, &pClientSocket->m_stServerSockaddr, &nSockAddrLen );
+//-------------------------------------------------------------------------------------------------
+//
+// AcceptBatch()
+//
+//-------------------------------------------------------------------------------------------------
+size_t CPassiveSocket::AcceptBatch( std::vector<std::unique_ptr<CActiveSocket>>& clients, size_t nMaxConnections,
+                                    CSocketRecycler* pRecycler )
+{
+   if ( m_nSocketType != CSimpleSocket::SocketTypeTcp )
+   {
+      SetSocketError( CSimpleSocket::SocketProtocolError );
+      return 0;
    }
-   else
+
+   size_t nAccepted = 0;
+
+   m_timer.SetStartTime();
+
+   while ( nAccepted < nMaxConnections )
    {
-      TranslateSocketError();
-      socketErrno = GetSocketError();
+      // Past the first, a blocking listener must only be asked for connections already queued
+      if ( nAccepted > 0 && m_bIsBlocking )
+      {
+         pollfd stPoll = { m_socket, POLLIN, 0 };
+         if ( POLL( &stPoll, 1, 0 ) <= 0 )
+         {
+            break;
+         }
+      }
+
+      sockaddr_in stPeer = {};
+      const SOCKET socket = AcceptNonblocking( stPeer );
+      if ( socket == INVALID_SOCKET )
+      {
+         TranslateSocketError();
+
+         // A peer which gave up while queued only costs its own connection, the rest still wait.
+         // Windows reports those as reset rather than aborted.
+         const CSimpleSocket::CSocketError error = GetSocketError();
+         if ( error == CSimpleSocket::SocketInterrupted || error == CSimpleSocket::SocketConnectionAborted ||
+              error == CSimpleSocket::SocketProtocolError || error == CSimpleSocket::SocketConnectionReset )
+         {
+            continue;
+         }
+
+         break;
+      }
+
+      auto pClientSocket = Adopt( socket, stPeer, pRecycler );
+      pClientSocket->m_bIsBlocking = false;
+
+      clients.push_back( std::move( pClientSocket ) );
+      ++nAccepted;
    }
-   //} while ( socketErrno == CSimpleSocket::SocketInterrupted );
 
    m_timer.SetEndTime();
 
-   if ( socketErrno != CSimpleSocket::SocketSuccess )
+   if ( nAccepted > 0 )
    {
-      pClientSocket = nullptr;
+      SetSocketError( CSimpleSocket::SocketSuccess );   // Running out of queued connections is expected
    }
 
+   return nAccepted;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::unique_ptr<CActiveSocket> CPassiveSocket::Adopt( SOCKET socket, const sockaddr_in& stPeer,
+                                                      CSocketRecycler* pRecycler ) const
+{
+   std::unique_ptr<CActiveSocket> pClientSocket =
+       ( pRecycler != nullptr ) ? pRecycler->Acquire( socket, CSimpleSocket::SocketTypeTcp ) :
+                                  std::make_unique<CActiveSocket>( socket, CSimpleSocket::SocketTypeTcp );
+
+   pClientSocket->m_stClientSockaddr = stPeer;
+   pClientSocket->m_stServerSockaddr = m_stServerSockaddr;
    return pClientSocket;
 }
+
+//-------------------------------------------------------------------------------------------------
+SOCKET CPassiveSocket::AcceptNonblocking( sockaddr_in& stPeer )
+{
+   socklen_t nSockAddrLen( SOCKET_ADDR_IN_SIZE );
+
+#ifdef _LINUX
+   return accept4( m_socket, reinterpret_cast<sockaddr*>( &stPeer ), &nSockAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC );
+#else
+   const SOCKET socket = ACCEPT( m_socket, &stPeer, &nSockAddrLen );
+   if ( socket != INVALID_SOCKET )
+   {
+#ifdef _WIN32
+      u_long nNonblocking = 1;
+      ioctlsocket( socket, FIONBIO, &nNonblocking );
+#else
+      fcntl( socket, F_SETFL, fcntl( socket, F_GETFL ) | O_NONBLOCK );
+      fcntl( socket, F_SETFD, FD_CLOEXEC );
+#endif
+   }
+
+   return socket;
+#endif
+}
@@ -5,16 +5,34 @@
 #define __PASSIVESOCKET_H__
 
 #include "ActiveSocket.h"
+#include "SocketRecycler.h"
 
 #include <memory>
+#include <vector>
 
 class CPassiveSocket : public CSimpleSocket
 {
 public:
    explicit CPassiveSocket( CSocketType type = SocketTypeTcp );
 
-   auto Accept() -> std::unique_ptr<CActiveSocket>;
+   /// @param pRecycler when given, the returned socket is drawn from it instead of allocated.
+   auto Accept( CSocketRecycler* pRecycler = nullptr ) -> std::unique_ptr<CActiveSocket>;
    bool Listen( const char* pAddr, uint16_t nPort, int32_t nConnectionBacklog = 30000 );
+
+   /// Accept every pending connection, up to nMaxConnections, in one call. The accepted sockets
+   /// are non-blocking and close-on-exec. A blocking listener only waits for the first one.
+   /// @return number of sockets appended to clients, zero with the reason set on failure.
+   size_t AcceptBatch( std::vector<std::unique_ptr<CActiveSocket>>& clients,
+                       size_t nMaxConnections = ACCEPT_BATCH_SIZE, CSocketRecycler* pRecycler = nullptr );
+
+   static constexpr size_t ACCEPT_BATCH_SIZE = 64;   /// connections taken per AcceptBatch()
+
+private:
+   /// accept4() where available, the peer address comes with the non-blocking handle.
+   SOCKET AcceptNonblocking( sockaddr_in& stPeer );
+
+   /// Wrap an accepted handle, the peer comes from accept() and the local address is the listener's.
+   std::unique_ptr<CActiveSocket> Adopt( SOCKET socket, const sockaddr_in& stPeer, CSocketRecycler* pRecycler ) const;
 };
 
 #endif   // __PASSIVESOCKET_H__
@@ -0,0 +1,200 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "Relay.h"
+
+#ifdef _LINUX
+
+#include <fcntl.h>
+#include <poll.h>
+
+#include <stdexcept>
+
+CRelay::CRelay( CSimpleSocket& first, CSimpleSocket& second, size_t nPipeSize )
+    : m_directions{ CDirection{ &first, &second }, CDirection{ &second, &first } }
+{
+   for ( CDirection& direction : m_directions )
+   {
+      if ( pipe2( direction.pipe.data(), O_NONBLOCK | O_CLOEXEC ) == CSimpleSocket::SocketError )
+      {
+         const std::string sReason = strerror( errno );
+         Teardown();
+         throw std::runtime_error( "Failed to create relay! " + sReason );
+      }
+
+      // A failed resize leaves the default capacity, which is read back either way
+      (void)fcntl( direction.pipe[ 1 ], F_SETPIPE_SZ, static_cast<int>( nPipeSize ) );
+      direction.nCapacity = static_cast<size_t>( fcntl( direction.pipe[ 1 ], F_GETPIPE_SZ ) );
+   }
+
+   first.SetNonblocking();
+   second.SetNonblocking();
+}
+
+CRelay::~CRelay()
+{
+   Teardown();
+}
+
+//-------------------------------------------------------------------------------------------------
+void CRelay::Teardown()
+{
+   for ( CDirection& direction : m_directions )
+   {
+      for ( int& nEnd : direction.pipe )
+      {
+         if ( nEnd != -1 ) CLOSE( nEnd );
+         nEnd = -1;
+      }
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// RunOnce()
+//
+//-------------------------------------------------------------------------------------------------
+int64_t CRelay::RunOnce( int32_t nTimeoutMs )
+{
+   // Each socket is read for one direction and written for the other
+   std::array<pollfd, 2> descriptors = {};
+   for ( size_t i = 0; i < m_directions.size(); ++i )
+   {
+      const CDirection& direction = m_directions[ i ];
+      descriptors[ i ].fd = direction.pFrom->m_socket;
+
+      if ( !direction.bEndOfStream && direction.nBuffered < direction.nCapacity ) descriptors[ i ].events |= POLLIN;
+
+      const CDirection& reverse = m_directions[ 1 - i ];
+      if ( reverse.nBuffered > 0 ) descriptors[ i ].events |= POLLOUT;
+   }
+
+   int nReady = 0;
+   do
+   {
+      nReady = poll( descriptors.data(), descriptors.size(), nTimeoutMs );
+   } while ( nReady == CSimpleSocket::SocketError && errno == EINTR );
+
+   if ( nReady <= 0 )
+   {
+      return nReady;
+   }
+
+   int64_t nMoved = 0;
+   for ( CDirection& direction : m_directions )
+   {
+      const int64_t nResult = Forward( direction );
+      if ( nResult == CSimpleSocket::SocketError )
+      {
+         return CSimpleSocket::SocketError;
+      }
+
+      nMoved += nResult;
+   }
+
+   return nMoved;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CRelay::Run()
+{
+   while ( !IsFinished() )
+   {
+      if ( RunOnce() == CSimpleSocket::SocketError )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Forward()
+//
+//-------------------------------------------------------------------------------------------------
+int64_t CRelay::Forward( CDirection& direction )
+{
+   int64_t nMoved = 0;
+
+   // Fill the pipe from the source, would block simply means nothing is waiting
+   while ( !direction.bEndOfStream && direction.nBuffered < direction.nCapacity )
+   {
+      const ssize_t nRead = splice( direction.pFrom->m_socket, nullptr, direction.pipe[ 1 ], nullptr,
+                                    direction.nCapacity - direction.nBuffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+      if ( nRead == CSimpleSocket::SocketError )
+      {
+         if ( errno == EINTR ) continue;
+         if ( errno == EAGAIN ) break;
+
+         direction.pFrom->TranslateSocketError();
+         return CSimpleSocket::SocketError;
+      }
+
+      if ( nRead == 0 )
+      {
+         direction.bEndOfStream = true;
+         break;
+      }
+
+      direction.nBuffered += static_cast<size_t>( nRead );
+   }
+
+   // Drain the pipe into the destination
+   while ( direction.nBuffered > 0 )
+   {
+      const ssize_t nWritten = splice( direction.pipe[ 0 ], nullptr, direction.pTo->m_socket, nullptr,
+                                       direction.nBuffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+      if ( nWritten == CSimpleSocket::SocketError )
+      {
+         if ( errno == EINTR ) continue;
+         if ( errno == EAGAIN ) break;
+
+         direction.pTo->TranslateSocketError();
+         return CSimpleSocket::SocketError;
+      }
+
+      direction.nBuffered -= static_cast<size_t>( nWritten );
+      direction.nForwarded += static_cast<uint64_t>( nWritten );
+      nMoved += nWritten;
+   }
+
+   // Propagate the half close once the destination has everything
+   if ( direction.bEndOfStream && direction.nBuffered == 0 && !direction.bDone )
+   {
+      if ( !direction.pTo->Shutdown( CSimpleSocket::Sends ) )
+      {
+         return CSimpleSocket::SocketError;
+      }
+
+      direction.bDone = true;
+   }
+
+   return nMoved;
+}
+
+#endif   // _LINUX
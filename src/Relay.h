@@ -0,0 +1,95 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#ifdef _LINUX
+
+#include "SimpleSocket.h"
+
+#include <array>
+
+/// Forwards a stream between two connected sockets in both directions without copying it
+/// through userspace, data is spliced from one socket into a pipe and from the pipe into
+/// the other. When one side finishes sending, the other side's sends are shut down once
+/// everything has been forwarded. Both sockets are switched to non-blocking and must
+/// outlive the relay.
+class CRelay
+{
+public:
+   /// @param nPipeSize bytes which may be in flight in each direction, rounded by the kernel.
+   /// @throws std::runtime_error if the pipes could not be created.
+   CRelay( CSimpleSocket& first, CSimpleSocket& second, size_t nPipeSize = 64 * 1024 );
+   CRelay( const CRelay& ) = delete;
+   CRelay( CRelay&& ) = delete;
+   ~CRelay();
+
+   CRelay& operator=( const CRelay& ) = delete;
+   CRelay& operator=( CRelay&& ) = delete;
+
+   /// Wait for either socket to be ready and forward whatever can be moved without blocking.
+   /// @param nTimeoutMs milliseconds to wait, -1 blocks until a socket is ready.
+   /// @return number of bytes forwarded, or -1 if either socket failed, the reason is set on it.
+   int64_t RunOnce( int32_t nTimeoutMs = -1 );
+
+   /// Forward until both directions are finished.
+   /// @return false if a socket failed before the stream ended.
+   bool Run();
+
+   /// @return true once both sides have finished sending and everything was forwarded.
+   [[nodiscard]] bool IsFinished() const { return m_directions[ 0 ].bDone && m_directions[ 1 ].bDone; }
+
+   /// @return bytes forwarded from the first socket to the second.
+   [[nodiscard]] uint64_t GetBytesForwarded() const { return m_directions[ 0 ].nForwarded; }
+
+   /// @return bytes forwarded from the second socket to the first.
+   [[nodiscard]] uint64_t GetBytesReturned() const { return m_directions[ 1 ].nForwarded; }
+
+private:
+   struct CDirection
+   {
+      CSimpleSocket* pFrom;
+      CSimpleSocket* pTo;
+      std::array<int, 2> pipe = { -1, -1 };   /// read and write ends
+      size_t nCapacity = 0;                  /// size of the pipe
+      size_t nBuffered = 0;                  /// bytes sitting in the pipe
+      uint64_t nForwarded = 0;               /// bytes written to pTo
+      bool bEndOfStream = false;             /// pFrom will not send anything more
+      bool bDone = false;                    /// everything forwarded and pTo shut down
+   };
+
+   void Teardown();
+
+   /// @return bytes moved, or -1 on error.
+   int64_t Forward( CDirection& direction );
+
+   std::array<CDirection, 2> m_directions;
+};
+
+#endif   // _LINUX
+
+#endif   // __RELAY_H__
@@ -0,0 +1,578 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "Resolver.h"
+#include "ResolverCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+   constexpr size_t HEADER_SIZE = 12;
+   constexpr size_t MAX_MESSAGE_SIZE = 512;   // Largest answer a server sends over UDP without EDNS
+   constexpr size_t MAX_NAME_LENGTH = 253;
+   constexpr size_t MAX_LABEL_LENGTH = 63;
+   constexpr int MAX_POINTERS = 16;   // Compression pointers followed in one name, stops loops
+
+   constexpr uint16_t TYPE_A = 1;
+   constexpr uint16_t CLASS_IN = 1;
+   constexpr uint16_t FLAG_RESPONSE = 0x8000;
+   constexpr uint16_t FLAG_TRUNCATED = 0x0200;
+   constexpr uint16_t FLAG_RECURSION_DESIRED = 0x0100;
+   constexpr uint16_t RCODE_MASK = 0x000F;
+   constexpr uint16_t RCODE_NAME_ERROR = 3;
+
+   uint16_t Read16( const uint8_t* pData ) { return static_cast<uint16_t>( ( pData[ 0 ] << 8 ) | pData[ 1 ] ); }
+
+   uint32_t Read32( const uint8_t* pData )
+   {
+      return ( static_cast<uint32_t>( Read16( pData ) ) << 16 ) | Read16( pData + 2 );
+   }
+
+   void Write16( std::vector<uint8_t>& message, uint16_t nValue )
+   {
+      message.push_back( static_cast<uint8_t>( nValue >> 8 ) );
+      message.push_back( static_cast<uint8_t>( nValue & 0xFF ) );
+   }
+
+   /// @return the name without the trailing dot of a fully qualified name.
+   std::string Unqualified( const std::string& sHost )
+   {
+      return ( !sHost.empty() && sHost.back() == '.' ) ? sHost.substr( 0, sHost.size() - 1 ) : sHost;
+   }
+
+   /// Encode a host name as length prefixed labels.
+   /// @return false if it is not a valid host name.
+   bool WriteName( std::vector<uint8_t>& message, const std::string& sHost )
+   {
+      const std::string sName = Unqualified( sHost );
+      if ( sName.empty() || sName.size() > MAX_NAME_LENGTH )
+      {
+         return false;
+      }
+
+      size_t nStart = 0;
+      while ( nStart <= sName.size() )
+      {
+         const size_t nEnd = std::min( sName.find( '.', nStart ), sName.size() );
+         const size_t nLabel = nEnd - nStart;
+         if ( nLabel == 0 || nLabel > MAX_LABEL_LENGTH )
+         {
+            return false;
+         }
+
+         message.push_back( static_cast<uint8_t>( nLabel ) );
+         message.insert( message.end(), sName.begin() + nStart, sName.begin() + nEnd );
+         nStart = nEnd + 1;
+      }
+
+      message.push_back( 0 );   // Root label
+      return true;
+   }
+
+   /// Decode a possibly compressed name, nOffset is moved past it.
+   /// @return false if the name runs outside the message.
+   bool ReadName( const uint8_t* pMessage, size_t nLength, size_t& nOffset, std::string& sName )
+   {
+      sName.clear();
+
+      size_t nPosition = nOffset;
+      int nPointers = 0;
+      while ( nPosition < nLength )
+      {
+         const uint8_t nLabel = pMessage[ nPosition ];
+         if ( ( nLabel & 0xC0 ) == 0xC0 )
+         {
+            if ( nPosition + 1 >= nLength || ++nPointers > MAX_POINTERS )
+            {
+               return false;
+            }
+
+            if ( nPointers == 1 ) nOffset = nPosition + 2;   // The name continues elsewhere
+            nPosition = ( static_cast<size_t>( nLabel & 0x3F ) << 8 ) | pMessage[ nPosition + 1 ];
+            continue;
+         }
+
+         if ( ( nLabel & 0xC0 ) != 0 || nPosition + 1 + nLabel > nLength )
+         {
+            return false;
+         }
+
+         if ( nLabel == 0 )
+         {
+            if ( nPointers == 0 ) nOffset = nPosition + 1;
+            return true;
+         }
+
+         if ( !sName.empty() ) sName += '.';
+         sName.append( reinterpret_cast<const char*>( pMessage + nPosition + 1 ), nLabel );
+         nPosition += 1 + nLabel;
+      }
+
+      return false;
+   }
+
+   bool EqualsIgnoreCase( const std::string& lhs, const std::string& rhs )
+   {
+      return lhs.size() == rhs.size() && std::equal( lhs.begin(), lhs.end(), rhs.begin(), []( char a, char b ) {
+                return std::tolower( static_cast<unsigned char>( a ) ) == std::tolower( static_cast<unsigned char>( b ) );
+             } );
+   }
+}   // namespace
+
+//-------------------------------------------------------------------------------------------------
+CResolver::CResolver( const char* pServer, uint16_t nPort ) : m_nPort( nPort )
+{
+   const std::string sServer = ( pServer != nullptr ) ? pServer : GetSystemServer();
+
+   if ( inet_pton( AF_INET, sServer.c_str(), &m_stServer ) != 1 )
+   {
+      throw std::runtime_error( "Failed to create resolver! " + sServer + " is not an IPv4 address" );
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Resolve()
+//
+//-------------------------------------------------------------------------------------------------
+bool CResolver::Resolve( const char* pHost, CCallback callback )
+{
+   if ( pHost == nullptr || !callback )
+   {
+      m_nError = CSimpleSocket::SocketInvalidPointer;
+      return false;
+   }
+
+   std::vector<in_addr> hosts( 1 );
+   if ( inet_pton( AF_INET, pHost, &hosts.front() ) == 1 )
+   {
+      callback( CSimpleSocket::SocketSuccess, hosts );
+      return true;
+   }
+
+   switch ( CResolverCache::GetShared().Find( pHost, hosts ) )
+   {
+   case CResolverCache::LookupFound:
+      callback( CSimpleSocket::SocketSuccess, hosts );
+      return true;
+   case CResolverCache::LookupFailed:
+      callback( CSimpleSocket::SocketInvalidAddress, {} );
+      return true;
+   case CResolverCache::LookupMiss:
+      break;
+   }
+
+   // Pick an identifier nobody else is waiting on, drawn from the system's secure source so
+   // earlier queries tell nothing about it
+   uint16_t nId = 0;
+   do
+   {
+      nId = static_cast<uint16_t>( std::random_device{}() );
+   } while ( m_queries.count( nId ) != 0 );
+
+   CQuery query;
+   query.sHost = pHost;
+   query.callback = std::move( callback );
+
+   Write16( query.message, nId );
+   Write16( query.message, FLAG_RECURSION_DESIRED );
+   Write16( query.message, 1 );   // Questions
+   Write16( query.message, 0 );   // Answers
+   Write16( query.message, 0 );   // Authorities
+   Write16( query.message, 0 );   // Additional records
+
+   if ( !WriteName( query.message, query.sHost ) )
+   {
+      m_nError = CSimpleSocket::SocketInvalidAddress;
+      return false;
+   }
+
+   Write16( query.message, TYPE_A );
+   Write16( query.message, CLASS_IN );
+
+   // A fresh socket is bound to a fresh ephemeral port, and connecting it makes the kernel
+   // drop datagrams from anyone but the server
+   query.pSocket = std::make_unique<CActiveSocket>( CSimpleSocket::SocketTypeUdp );
+   if ( !query.pSocket->SetNonblocking() || !query.pSocket->StartConnect( m_stServer, m_nPort ) )
+   {
+      m_nError = query.pSocket->GetSocketError();
+      return false;
+   }
+
+   CQuery& pending = m_queries.emplace( nId, std::move( query ) ).first->second;
+   if ( !Send( pending ) )
+   {
+      m_nError = pending.pSocket->GetSocketError();
+      m_queries.erase( nId );
+      return false;
+   }
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Open()
+//
+//-------------------------------------------------------------------------------------------------
+bool CResolver::Open( CActiveSocket& socket, const char* pAddr, uint16_t nPort, COpenCallback callback )
+{
+   if ( !socket.Validate( pAddr, nPort ) )
+   {
+      return false;
+   }
+
+   if ( socket.GetSocketType() != CSimpleSocket::SocketTypeTcp )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketProtocolError );
+      return false;
+   }
+
+   if ( !socket.IsNonblocking() || !callback )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidOperation );
+      return false;
+   }
+
+   CActiveSocket* pSocket = &socket;
+   const bool bRetVal =
+       Resolve( pAddr, [pSocket, nPort, callback]( CSimpleSocket::CSocketError nError, const std::vector<in_addr>& hosts ) {
+          if ( nError == CSimpleSocket::SocketSuccess )
+          {
+             pSocket->StartConnect( hosts.front(), nPort );
+          }
+          else
+          {
+             pSocket->SetSocketError( nError );
+          }
+
+          callback( pSocket->GetSocketError() );
+       } );
+
+   if ( !bRetVal )
+   {
+      socket.SetSocketError( m_nError );
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Process()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CResolver::Process()
+{
+   // Callbacks run last since they may start new lookups
+   std::vector<std::pair<CCallback, CAnswer>> finished;
+
+   for ( auto itor = m_queries.begin(); itor != m_queries.end(); )
+   {
+      CQuery& query = itor->second;
+      CAnswer answer{ CSimpleSocket::SocketTimedout, {}, std::chrono::milliseconds( 0 ) };
+
+      bool bFinished = query.bStream ? ReadStream( itor->first, query, answer )
+                                     : ReadDatagrams( itor->first, query, answer );
+      if ( !bFinished && query.deadline <= Clock::now() )
+      {
+         bFinished = query.nAttempts >= m_nAttempts;
+         if ( !bFinished )
+         {
+            Send( query );   // A failed retry is left to time out
+         }
+      }
+
+      if ( !bFinished )
+      {
+         ++itor;
+         continue;
+      }
+
+      if ( answer.nError == CSimpleSocket::SocketSuccess )
+      {
+         CResolverCache::GetShared().Store( query.sHost, answer.hosts, answer.ttl );
+      }
+      else if ( answer.nError == CSimpleSocket::SocketInvalidAddress )
+      {
+         CResolverCache::GetShared().Store( query.sHost, {} );
+      }
+
+      finished.emplace_back( std::move( query.callback ), std::move( answer ) );
+      itor = m_queries.erase( itor );
+   }
+
+   for ( auto& item : finished )
+   {
+      item.first( item.second.nError, item.second.hosts );
+   }
+
+   return static_cast<int32_t>( finished.size() );
+}
+
+//-------------------------------------------------------------------------------------------------
+std::vector<CResolver::CWatch> CResolver::GetSockets() const
+{
+   std::vector<CWatch> sockets;
+   sockets.reserve( m_queries.size() );
+
+   for ( const auto& item : m_queries )
+   {
+      const CQuery& query = item.second;
+      const bool bConnecting = query.bStream && !query.bSent;
+      sockets.push_back(
+          { query.pSocket.get(), bConnecting ? CSimpleSocket::ReadinessWritable : CSimpleSocket::ReadinessReadable } );
+   }
+
+   return sockets;
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CResolver::GetTimeoutMs() const
+{
+   if ( m_queries.empty() )
+   {
+      return -1;
+   }
+
+   auto deadline = Clock::time_point::max();
+   for ( const auto& item : m_queries )
+   {
+      deadline = std::min( deadline, item.second.deadline );
+   }
+
+   const auto remaining = std::chrono::ceil<std::chrono::milliseconds>( deadline - Clock::now() );
+   return static_cast<int32_t>( std::max<int64_t>( remaining.count(), 0 ) );
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolver::SetTimeout( int32_t nTimeoutMs, uint32_t nAttempts )
+{
+   m_nTimeoutMs = nTimeoutMs;
+   m_nAttempts = std::max<uint32_t>( nAttempts, 1 );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CResolver::Send( CQuery& query )
+{
+   ++query.nAttempts;
+   query.deadline = Clock::now() + std::chrono::milliseconds( m_nTimeoutMs );
+
+   if ( query.bStream )
+   {
+      // Every attempt connects again, the question is written once the connection completes
+      query.pSocket = std::make_unique<CActiveSocket>( CSimpleSocket::SocketTypeTcp );
+      query.bSent = false;
+      query.response.clear();
+      return query.pSocket->SetNonblocking() && query.pSocket->StartConnect( m_stServer, m_nPort );
+   }
+
+   return query.pSocket->Send( query.message.data(), query.message.size() ) ==
+          static_cast<int32_t>( query.message.size() );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CResolver::ReadDatagrams( uint16_t nId, CQuery& query, CAnswer& answer )
+{
+   std::array<uint8_t, MAX_MESSAGE_SIZE> buffer;
+
+   int32_t nReceived = 0;
+   while ( ( nReceived = query.pSocket->Receive( buffer.size(), buffer.data() ) ) >= 0 )
+   {
+      // Late answers to an earlier query on the same port, and forgeries, are dropped
+      if ( static_cast<size_t>( nReceived ) < HEADER_SIZE || Read16( buffer.data() ) != nId )
+      {
+         continue;
+      }
+
+      const uint16_t nFlags = Read16( buffer.data() + 2 );
+      if ( ( nFlags & FLAG_RESPONSE ) != 0 && ( nFlags & FLAG_TRUNCATED ) != 0 )
+      {
+         // The answer did not fit, the server sends all of it over TCP
+         query.bStream = true;
+         Send( query );   // A failed connect is left to time out
+         return false;
+      }
+
+      if ( Parse( buffer.data(), nReceived, query, answer ) )
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CResolver::ReadStream( uint16_t nId, CQuery& query, CAnswer& answer )
+{
+   CActiveSocket& socket = *query.pSocket;
+
+   if ( !query.bSent )
+   {
+      if ( !socket.Select( CSimpleSocket::ReadinessWritable, 0, 0 ) )
+      {
+         return false;   // Still connecting, or refused and left to time out
+      }
+
+      // Messages over TCP are preceded by their length
+      std::vector<uint8_t> framed;
+      Write16( framed, static_cast<uint16_t>( query.message.size() ) );
+      framed.insert( framed.end(), query.message.begin(), query.message.end() );
+
+      if ( socket.Send( framed.data(), framed.size() ) != static_cast<int32_t>( framed.size() ) )
+      {
+         return false;
+      }
+
+      query.bSent = true;
+   }
+
+   std::array<uint8_t, MAX_MESSAGE_SIZE> buffer;
+   int32_t nReceived = 0;
+   while ( ( nReceived = socket.Receive( buffer.size(), buffer.data() ) ) > 0 )
+   {
+      query.response.insert( query.response.end(), buffer.begin(), buffer.begin() + nReceived );
+   }
+
+   if ( query.response.size() < 2 || query.response.size() - 2 < Read16( query.response.data() ) )
+   {
+      if ( nReceived == 0 )
+      {
+         answer.nError = CSimpleSocket::SocketProtocolError;   // Closed part way through
+         return true;
+      }
+
+      return false;
+   }
+
+   const uint8_t* pMessage = query.response.data() + 2;
+   const size_t nLength = Read16( query.response.data() );
+   if ( nLength < HEADER_SIZE || Read16( pMessage ) != nId || !Parse( pMessage, nLength, query, answer ) )
+   {
+      answer.nError = CSimpleSocket::SocketProtocolError;
+   }
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Parse()
+//
+//-------------------------------------------------------------------------------------------------
+bool CResolver::Parse( const uint8_t* pMessage, size_t nLength, const CQuery& query, CAnswer& answer )
+{
+   const uint16_t nFlags = Read16( pMessage + 2 );
+   if ( ( nFlags & FLAG_RESPONSE ) == 0 || Read16( pMessage + 4 ) != 1 )
+   {
+      return false;
+   }
+
+   // The question is echoed back, it must be the one asked
+   size_t nOffset = HEADER_SIZE;
+   std::string sName;
+   if ( !ReadName( pMessage, nLength, nOffset, sName ) || nOffset + 4 > nLength ||
+        !EqualsIgnoreCase( sName, Unqualified( query.sHost ) ) || Read16( pMessage + nOffset ) != TYPE_A ||
+        Read16( pMessage + nOffset + 2 ) != CLASS_IN )
+   {
+      return false;
+   }
+
+   nOffset += 4;
+
+   const uint16_t nCode = nFlags & RCODE_MASK;
+   if ( nCode != 0 )
+   {
+      answer.nError = ( nCode == RCODE_NAME_ERROR ) ? CSimpleSocket::SocketInvalidAddress : CSimpleSocket::SocketProtocolError;
+      return true;
+   }
+
+   // Aliases are followed by the server, so every address record belongs to the name asked
+   answer.ttl = std::chrono::milliseconds::max();
+   const uint16_t nAnswers = Read16( pMessage + 6 );
+   for ( uint16_t i = 0; i < nAnswers; ++i )
+   {
+      if ( !ReadName( pMessage, nLength, nOffset, sName ) || nOffset + 10 > nLength )
+      {
+         return false;
+      }
+
+      const uint16_t nType = Read16( pMessage + nOffset );
+      const uint16_t nClass = Read16( pMessage + nOffset + 2 );
+      const uint32_t nTtl = Read32( pMessage + nOffset + 4 );
+      const uint16_t nData = Read16( pMessage + nOffset + 8 );
+      nOffset += 10;
+
+      if ( nOffset + nData > nLength )
+      {
+         return false;
+      }
+
+      if ( nType == TYPE_A && nClass == CLASS_IN && nData == sizeof( in_addr ) )
+      {
+         in_addr stHost = {};
+         std::memcpy( &stHost, pMessage + nOffset, sizeof( stHost ) );
+         answer.hosts.push_back( stHost );
+         answer.ttl = std::min<std::chrono::milliseconds>( answer.ttl, std::chrono::seconds( nTtl ) );
+      }
+
+      nOffset += nData;
+   }
+
+   // A name without addresses is as good as one which does not exist
+   answer.nError = answer.hosts.empty() ? CSimpleSocket::SocketInvalidAddress : CSimpleSocket::SocketSuccess;
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+std::string CResolver::GetSystemServer()
+{
+   std::ifstream config( "/etc/resolv.conf" );
+   std::string sLine;
+   while ( std::getline( config, sLine ) )
+   {
+      std::istringstream fields( sLine );
+      std::string sKey;
+      std::string sValue;
+      in_addr stHost = {};
+
+      if ( fields >> sKey >> sValue && sKey == "nameserver" && inet_pton( AF_INET, sValue.c_str(), &stHost ) == 1 )
+      {
+         return sValue;
+      }
+   }
+
+   return "127.0.0.1";
+}
@@ -0,0 +1,147 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __RESOLVER_H__
+#define __RESOLVER_H__
+
+#include "ActiveSocket.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Non-blocking DNS client which looks up IPv4 addresses by querying a name server directly,
+/// so an event driven thread never waits on the system resolver. Watch GetSockets() with an
+/// event loop or a CSocketSet, and call Process() when one is ready or when GetTimeoutMs()
+/// has elapsed. Answers are stored in the shared CResolverCache. Every query is sent from its
+/// own socket so its source port is as hard to guess as its identifier, and an answer too
+/// large for a datagram is asked for again over TCP.
+class CResolver
+{
+public:
+   /// Outcome of a lookup, CSimpleSocket::SocketSuccess with at least one address,
+   /// SocketInvalidAddress if the name does not exist, SocketTimedout if the server never
+   /// answered or SocketProtocolError if it could not answer.
+   using CCallback = std::function<void( CSimpleSocket::CSocketError nError, const std::vector<in_addr>& hosts )>;
+
+   /// Outcome of Open(), CSimpleSocket::SocketEinprogress while the connection completes, wait
+   /// for CSimpleSocket::ReadinessWritable, or the error which stopped it.
+   using COpenCallback = std::function<void( CSimpleSocket::CSocketError nError )>;
+
+   /// Socket of an outstanding query and the mask of CSimpleSocket::CReadiness it waits for.
+   struct CWatch
+   {
+      CSimpleSocket* pSocket;
+      uint32_t nInterest;
+   };
+
+   static constexpr int32_t DEFAULT_TIMEOUT_MS = 1000;
+   static constexpr uint32_t DEFAULT_ATTEMPTS = 3;
+   static constexpr uint16_t DNS_PORT = 53;
+
+   /// @param pServer IPv4 address of the name server, NULL uses the first one of /etc/resolv.conf.
+   /// @throws std::runtime_error if the server is not an IPv4 address.
+   explicit CResolver( const char* pServer = nullptr, uint16_t nPort = DNS_PORT );
+
+   /// Start looking up pHost. Literal and cached addresses are answered before this returns.
+   /// @return false if the name is not valid or the query could not be sent.
+   bool Resolve( const char* pHost, CCallback callback );
+
+   /// Look up pAddr then start connecting the socket to the first address. Only valid on
+   /// non-blocking CSocketType::SocketTypeTcp sockets, which must outlive the lookup.
+   /// @return false if the lookup could not be started, the reason is set on the socket.
+   bool Open( CActiveSocket& socket, const char* pAddr, uint16_t nPort, COpenCallback callback );
+
+   /// Handle the answers which arrived and the queries which timed out, never blocks.
+   /// @return number of callbacks invoked.
+   int32_t Process();
+
+   /// @return milliseconds until Process() has a query to retry or expire, -1 when idle.
+   [[nodiscard]] int32_t GetTimeoutMs() const;
+
+   /// @return sockets of the outstanding queries. They are created by Resolve() and Open() and
+   /// closed once Process() finishes their query, so watch them again after either call.
+   [[nodiscard]] std::vector<CWatch> GetSockets() const;
+
+   /// @return reason the last Resolve() which returned false failed.
+   [[nodiscard]] CSimpleSocket::CSocketError GetSocketError() const { return m_nError; }
+
+   [[nodiscard]] size_t GetPendingCount() const { return m_queries.size(); }
+
+   /// @param nTimeoutMs how long to wait for each attempt before the query is sent again.
+   /// @param nAttempts how many times a query is sent before it times out.
+   void SetTimeout( int32_t nTimeoutMs, uint32_t nAttempts );
+
+private:
+   using Clock = std::chrono::steady_clock;
+
+   struct CQuery
+   {
+      std::string sHost;
+      std::vector<uint8_t> message;   /// encoded question, kept for retries
+      CCallback callback;
+      uint32_t nAttempts = 0;         /// times sent so far
+      Clock::time_point deadline;     /// when the current attempt times out
+
+      std::unique_ptr<CActiveSocket> pSocket;   /// connected to the server, used by this query only
+      bool bStream = false;                     /// asking over TCP after a truncated answer
+      bool bSent = false;                       /// the question went out over the stream
+      std::vector<uint8_t> response;            /// length prefixed answer read from the stream so far
+   };
+
+   struct CAnswer
+   {
+      CSimpleSocket::CSocketError nError;
+      std::vector<in_addr> hosts;
+      std::chrono::milliseconds ttl;
+   };
+
+   bool Send( CQuery& query );
+
+   /// Read what arrived for a query.
+   /// @return true once the query is finished, with the outcome in answer.
+   bool ReadDatagrams( uint16_t nId, CQuery& query, CAnswer& answer );
+   bool ReadStream( uint16_t nId, CQuery& query, CAnswer& answer );
+
+   /// Decode a response whose transaction identifier matches the query.
+   /// @return false if the message is malformed or does not answer the query.
+   static bool Parse( const uint8_t* pMessage, size_t nLength, const CQuery& query, CAnswer& answer );
+
+   /// @return the first IPv4 name server of /etc/resolv.conf, or the loopback address.
+   static std::string GetSystemServer();
+
+   in_addr m_stServer = {};
+   uint16_t m_nPort = DNS_PORT;
+   std::unordered_map<uint16_t, CQuery> m_queries;   /// outstanding queries by transaction identifier
+   CSimpleSocket::CSocketError m_nError = CSimpleSocket::SocketSuccess;
+   int32_t m_nTimeoutMs = DEFAULT_TIMEOUT_MS;
+   uint32_t m_nAttempts = DEFAULT_ATTEMPTS;
+};
+
+#endif   // __RESOLVER_H__
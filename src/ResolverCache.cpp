@@ -0,0 +1,145 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "ResolverCache.h"
+
+#include <algorithm>
+
+//-------------------------------------------------------------------------------------------------
+CResolverCache& CResolverCache::GetShared()
+{
+   static CResolverCache cache;
+   return cache;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Find()
+//
+//-------------------------------------------------------------------------------------------------
+CResolverCache::CLookup CResolverCache::Find( const std::string& sHost, std::vector<in_addr>& addresses )
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+
+   const auto itor = m_entries.find( sHost );
+   if ( itor == m_entries.end() )
+   {
+      return LookupMiss;
+   }
+
+   if ( itor->second.expiry <= Clock::now() )
+   {
+      m_entries.erase( itor );
+      return LookupMiss;
+   }
+
+   if ( itor->second.addresses.empty() )
+   {
+      return LookupFailed;
+   }
+
+   addresses = itor->second.addresses;
+   return LookupFound;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Store()
+//
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::Store( const std::string& sHost, const std::vector<in_addr>& addresses )
+{
+   Store( sHost, addresses, std::chrono::milliseconds::max() );
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::Store( const std::string& sHost, const std::vector<in_addr>& addresses,
+                            std::chrono::milliseconds ttl )
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+
+   ttl = std::min( ttl, addresses.empty() ? m_negativeTtl : m_ttl );
+   if ( ttl.count() <= 0 || m_nCapacity == 0 )
+   {
+      m_entries.erase( sHost );   // Do not keep serving an older result
+      return;
+   }
+
+   const auto now = Clock::now();
+   if ( m_entries.size() >= m_nCapacity && m_entries.find( sHost ) == m_entries.end() )
+   {
+      Evict( now );
+   }
+
+   m_entries[ sHost ] = { addresses, now, now + ttl };
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::Evict( Clock::time_point now )
+{
+   for ( auto itor = m_entries.begin(); itor != m_entries.end(); )
+   {
+      itor = ( itor->second.expiry <= now ) ? m_entries.erase( itor ) : std::next( itor );
+   }
+
+   if ( m_entries.size() >= m_nCapacity )
+   {
+      // By age rather than expiry, a short lived failure is no less useful than an older address
+      using CItem = decltype( m_entries )::value_type;
+      m_entries.erase( std::min_element( m_entries.begin(), m_entries.end(), []( const CItem& lhs, const CItem& rhs ) {
+         return lhs.second.stored < rhs.second.stored;
+      } ) );
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::Invalidate( const std::string& sHost )
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   m_entries.erase( sHost );
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::Clear()
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   m_entries.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+void CResolverCache::SetTimeToLive( std::chrono::milliseconds ttl, std::chrono::milliseconds negativeTtl )
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   m_ttl = ttl;
+   m_negativeTtl = negativeTtl;
+}
+
+//-------------------------------------------------------------------------------------------------
+size_t CResolverCache::GetSize() const
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   return m_entries.size();
+}
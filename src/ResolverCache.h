@@ -0,0 +1,96 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __RESOLVERCACHE_H__
+#define __RESOLVERCACHE_H__
+
+#include "SimpleSocket.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Remembers the IPv4 addresses host names resolved to so repeated connects skip the system
+/// resolver. Names which failed to resolve are remembered too, for a shorter time. Safe to
+/// use from several threads, CActiveSocket::Open() consults the shared instance.
+class CResolverCache
+{
+public:
+   enum CLookup
+   {
+      LookupMiss,    ///< Not cached or expired, the resolver must be asked.
+      LookupFound,   ///< The addresses are known.
+      LookupFailed   ///< The name recently failed to resolve.
+   };
+
+   static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+   explicit CResolverCache( size_t nCapacity = DEFAULT_CAPACITY ) : m_nCapacity( nCapacity ) {}
+
+   /// @return the instance used by every CActiveSocket.
+   static CResolverCache& GetShared();
+
+   /// @param addresses receives the cached addresses when LookupFound is returned.
+   CLookup Find( const std::string& sHost, std::vector<in_addr>& addresses );
+
+   /// Remember the outcome of a lookup, no addresses records a failure.
+   void Store( const std::string& sHost, const std::vector<in_addr>& addresses );
+
+   /// Remember addresses for no longer than the record's own time to live.
+   void Store( const std::string& sHost, const std::vector<in_addr>& addresses, std::chrono::milliseconds ttl );
+
+   /// Forget one name, for instance after connecting to its addresses failed.
+   void Invalidate( const std::string& sHost );
+   void Clear();
+
+   /// How long results are kept, zero stops that kind of result from being cached.
+   void SetTimeToLive( std::chrono::milliseconds ttl, std::chrono::milliseconds negativeTtl );
+
+   [[nodiscard]] size_t GetSize() const;
+
+private:
+   using Clock = std::chrono::steady_clock;
+
+   struct CEntry
+   {
+      std::vector<in_addr> addresses;   ///< Empty for a name which failed to resolve.
+      Clock::time_point stored;
+      Clock::time_point expiry;
+   };
+
+   /// Make room for one more entry, dropping expired ones first and then the oldest.
+   void Evict( Clock::time_point now );
+
+   mutable std::mutex m_mutex;
+   std::unordered_map<std::string, CEntry> m_entries;
+   std::chrono::milliseconds m_ttl = std::chrono::seconds( 30 );          /// how long addresses are kept
+   std::chrono::milliseconds m_negativeTtl = std::chrono::seconds( 5 );   /// how long failures are kept
+   size_t m_nCapacity;
+};
+
+#endif   // __RESOLVERCACHE_H__
@@ -43,14 +43,26 @@
 
 #include "SimpleSocket.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
-#include <functional>
 #include <stdexcept>
 #include <array>
+#include <vector>
 
 #if defined( _LINUX ) || defined( _DARWIN )
 #include <fcntl.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
+#endif
+
+#ifdef _LINUX
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#elif defined( _DARWIN )
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef _WIN32
@@ -59,6 +71,14 @@
 static constexpr auto IPTOS_LOWDELAY = 0x10;
 #endif
 
+// Used by SendAll() and ReceiveExactly() so a blocking call cannot outlast a deadline. Where the
+// flag is missing the socket is made non-blocking for the call instead.
+#ifdef MSG_DONTWAIT
+static constexpr int32_t TRANSFER_DONTWAIT = MSG_DONTWAIT;
+#else
+static constexpr int32_t TRANSFER_DONTWAIT = 0;
+#endif
+
 CSimpleSocket::CSimpleSocket( CSocketType nType ) : m_nSocketType( nType )
 {
    if ( nType == SocketTypeTcp || nType == SocketTypeUdp )
@@ -72,6 +92,17 @@ CSimpleSocket::CSimpleSocket( CSocketType nType ) : m_nSocketType( nType )
    }
 }
 
+CSimpleSocket::CSimpleSocket( SOCKET socket, CSocketType nType ) : m_socket( socket ), m_nSocketType( nType )
+{
+   if ( nType == SocketTypeTcp || nType == SocketTypeUdp )
+   {
+      m_nSocketDomain = AF_INET;
+   }
+
+   m_bDeferredHandle = !IsSocketValid();
+   SetSocketError( IsSocketValid() ? SocketSuccess : SocketInvalidSocket );
+}
+
 CSimpleSocket::CSimpleSocket( CSimpleSocket&& socket ) noexcept
 {
    swap( *this, socket );
@@ -96,7 +127,9 @@ void swap( CSimpleSocket& lhs, CSimpleSocket& rhs ) noexcept
 
    swap( lhs.m_socket, rhs.m_socket );
    swap( lhs.m_error, rhs.m_error );
-   swap( lhs.m_sBuffer, rhs.m_sBuffer );
+   swap( lhs.m_pBuffer, rhs.m_pBuffer );
+   swap( lhs.m_nBufferCapacity, rhs.m_nBufferCapacity );
+   swap( lhs.m_nBufferLength, rhs.m_nBufferLength );
    swap( lhs.m_nSocketDomain, rhs.m_nSocketDomain );
    swap( lhs.m_nSocketType, rhs.m_nSocketType );
    swap( lhs.m_nBytesReceived, rhs.m_nBytesReceived );
@@ -104,17 +137,28 @@ void swap( CSimpleSocket& lhs, CSimpleSocket& rhs ) noexcept
    swap( lhs.m_nFlags, rhs.m_nFlags );
    swap( lhs.m_bIsMulticast, rhs.m_bIsMulticast );
    swap( lhs.m_bIsBlocking, rhs.m_bIsBlocking );
+   swap( lhs.m_bIsCorked, rhs.m_bIsCorked );
+   swap( lhs.m_bDeferredHandle, rhs.m_bDeferredHandle );
+   swap( lhs.m_nReadiness, rhs.m_nReadiness );
+   swap( lhs.m_nZeroCopyNext, rhs.m_nZeroCopyNext );
+   swap( lhs.m_bZeroCopy, rhs.m_bZeroCopy );
 
-   swap( lhs.m_stConnectTimeout, rhs.m_stConnectTimeout );
-   swap( lhs.m_stRecvTimeout, rhs.m_stRecvTimeout );
-   swap( lhs.m_stSendTimeout, rhs.m_stSendTimeout );
-
-   swap( lhs.m_stLinger.l_onoff, rhs.m_stLinger.l_onoff );
-   swap( lhs.m_stLinger.l_linger, rhs.m_stLinger.l_linger );
+   swap( lhs.m_pSettings, rhs.m_pSettings );
 
    swap( lhs.m_stClientSockaddr, rhs.m_stClientSockaddr );
    swap( lhs.m_stServerSockaddr, rhs.m_stServerSockaddr );
-   swap( lhs.m_stMulticastGroup, rhs.m_stMulticastGroup );
+}
+
+const CSimpleSocket::CSettings CSimpleSocket::DEFAULT_SETTINGS{};
+
+CSimpleSocket::CSettings& CSimpleSocket::GetMutableSettings()
+{
+   if ( m_pSettings == nullptr )
+   {
+      m_pSettings = std::make_unique<CSettings>();
+   }
+
+   return *m_pSettings;
 }
 
 bool CSimpleSocket::ObtainNewHandle()
@@ -122,9 +166,9 @@ bool CSimpleSocket::ObtainNewHandle()
    errno = CSimpleSocket::SocketSuccess;
 
 #ifdef _WIN32
-   // Data structure containing general Windows Sockets Info
-   memset( &m_hWSAData, 0, sizeof( m_hWSAData ) );
-   WSAStartup( MAKEWORD( 2, 2 ), &m_hWSAData );
+   // Data structure containing general Windows Sockets Info, nothing in it is needed afterwards
+   WSADATA stWSAData = {};
+   WSAStartup( MAKEWORD( 2, 2 ), &stWSAData );
 #endif
 
    m_timer.SetStartTime();
@@ -136,6 +180,37 @@ bool CSimpleSocket::ObtainNewHandle()
    return IsSocketValid();
 }
 
+void CSimpleSocket::Reset( SOCKET socket, CSocketType nType )
+{
+   Close();
+
+   CSimpleSocket fresh( socket, nType );
+
+   using std::swap;
+   swap( fresh.m_pBuffer, m_pBuffer );
+   swap( fresh.m_nBufferCapacity, m_nBufferCapacity );
+   swap( *this, fresh );
+
+   m_timer = CStatTimer();
+}
+
+bool CSimpleSocket::EnsureHandle()
+{
+   if ( IsSocketValid() )
+   {
+      return true;
+   }
+
+   if ( !m_bDeferredHandle )
+   {
+      SetSocketError( SocketInvalidSocket );
+      return false;
+   }
+
+   m_bDeferredHandle = false;
+   return ObtainNewHandle();
+}
+
 //-------------------------------------------------------------------------------------------------
 //
 // BindInterface()
@@ -226,6 +301,31 @@ bool CSimpleSocket::SetMulticast( bool bEnable, uint8_t multicastTTL )
    return bRetVal;
 }
 
+//-------------------------------------------------------------------------------------------------
+//
+// SetReceiveCoalescing()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetReceiveCoalescing( bool bEnable )
+{
+   if ( GetSocketType() != CSimpleSocket::SocketTypeUdp )
+   {
+      SetSocketError( CSimpleSocket::SocketProtocolError );
+      return false;
+   }
+
+#if defined( _LINUX ) && defined( UDP_GRO )
+   const int32_t nEnable = bEnable ? 1 : 0;
+   const bool bRetVal = ( SETSOCKOPT( m_socket, SOL_UDP, UDP_GRO, &nEnable, sizeof( nEnable ) ) == SocketSuccess );
+   TranslateSocketError();
+
+   return bRetVal;
+#else
+   SetSocketError( bEnable ? CSimpleSocket::SocketProtocolError : CSimpleSocket::SocketSuccess );
+   return !bEnable;
+#endif
+}
+
 //-------------------------------------------------------------------------------------------------
 //
 // JoinMulticast()
@@ -248,12 +348,13 @@ bool CSimpleSocket::JoinMulticast( const char* pGroup, uint16_t nPort )
 
    if ( bRetVal )
    {
-      m_stMulticastGroup.sin_family = AF_INET;
-      m_stMulticastGroup.sin_port = htons( nPort );
-      m_stMulticastGroup.sin_addr.s_addr = htonl( INADDR_ANY ),
+      sockaddr_in& stMulticastGroup = GetMutableSettings().stMulticastGroup;
+      stMulticastGroup.sin_family = AF_INET;
+      stMulticastGroup.sin_port = htons( nPort );
+      stMulticastGroup.sin_addr.s_addr = htonl( INADDR_ANY );
 
       // Bind to the specified port
-          bRetVal = ( BIND( m_socket, &m_stMulticastGroup, SOCKET_ADDR_IN_SIZE ) == SocketSuccess );
+      bRetVal = ( BIND( m_socket, &stMulticastGroup, SOCKET_ADDR_IN_SIZE ) == SocketSuccess );
    }
 
    if ( bRetVal )
@@ -272,7 +373,7 @@ bool CSimpleSocket::JoinMulticast( const char* pGroup, uint16_t nPort )
    if ( bRetVal )
    {
       // Save group address
-      inet_pton( m_nSocketDomain, pGroup, &m_stMulticastGroup.sin_addr.s_addr );
+      inet_pton( m_nSocketDomain, pGroup, &GetMutableSettings().stMulticastGroup.sin_addr.s_addr );
 
       // Save local info
       socklen_t nSockLen = SOCKET_ADDR_IN_SIZE;
@@ -325,7 +426,7 @@ std::string CSimpleSocket::GetServerAddr()
 std::string CSimpleSocket::GetJoinedGroup()
 {
    std::array<char, INET_ADDRSTRLEN + 1> buff = { '\0' };
-   if ( inet_ntop( m_nSocketDomain, &m_stMulticastGroup.sin_addr, buff.data(), INET_ADDRSTRLEN ) == nullptr )
+   if ( inet_ntop( m_nSocketDomain, &GetSettings().stMulticastGroup.sin_addr, buff.data(), INET_ADDRSTRLEN ) == nullptr )
    {
       TranslateSocketError();
       return DescribeError();
@@ -494,6 +595,12 @@ bool CSimpleSocket::EnableNagleAlgoritm()
 //
 //-------------------------------------------------------------------------------------------------
 int32_t CSimpleSocket::Send( const uint8_t* pBuf, size_t bytesToSend )
+{
+   return Send( pBuf, bytesToSend, SendDefault );
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::Send( const uint8_t* pBuf, size_t bytesToSend, uint32_t nSendFlags )
 {
    if ( !IsSocketValid() || bytesToSend == 0 || pBuf == nullptr )
    {
@@ -502,24 +609,32 @@ int32_t CSimpleSocket::Send( const uint8_t* pBuf, size_t bytesToSend )
       return m_nBytesSent;
    }
 
+   if ( m_nSocketType != SocketTypeTcp && m_nSocketType != SocketTypeUdp )
+   {
+      SetSocketError( SocketProtocolError );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
+
    SetSocketError( SocketSuccess );
-   m_nBytesSent = 0;
 
-   std::function<int32_t()> sendMessage = [] { return -1; };
-   if ( m_nSocketType == SocketTypeTcp )
-      sendMessage = [&] { return SEND( m_socket, pBuf, bytesToSend, 0 ); };
-   else if ( m_nSocketType == SocketTypeUdp )
-      sendMessage = [&] {
-         const auto addrToSentTo = reinterpret_cast<const sockaddr*>( GetUdpTxAddrBuffer() );
-         return SENDTO( m_socket, pBuf, bytesToSend, 0, addrToSentTo, SOCKET_ADDR_IN_SIZE );
-      };
+   int32_t nFlags = 0;
+#ifdef MSG_MORE
+   if ( nSendFlags & SendMore ) nFlags |= MSG_MORE;
+#endif
+
+   // Datagrams always go to the same place, look it up once rather than per attempt
+   const auto addrToSentTo =
+       ( m_nSocketType == SocketTypeUdp ) ? reinterpret_cast<const sockaddr*>( GetUdpTxAddrBuffer() ) : nullptr;
 
    m_timer.SetStartTime();
 
    // Check error condition and attempt to resend if call was interrupted by a signal.
    do
    {
-      m_nBytesSent += sendMessage();
+      m_nBytesSent = ( addrToSentTo == nullptr )
+                         ? SEND( m_socket, pBuf, bytesToSend, nFlags )
+                         : SENDTO( m_socket, pBuf, bytesToSend, nFlags, addrToSentTo, SOCKET_ADDR_IN_SIZE );
       TranslateSocketError();
    } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
 
@@ -529,236 +644,1250 @@ int32_t CSimpleSocket::Send( const uint8_t* pBuf, size_t bytesToSend )
 }
 
 //-------------------------------------------------------------------------------------------------
-//
-// Close() - Close socket and free up any memory allocated for the socket
-//
-//-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::Close()
+int32_t CSimpleSocket::Send( const iovec* pVectors, size_t nCount )
 {
-   bool bRetVal = false;
-
-   // if socket handle is currently valid, close and then invalidate
-   if ( IsSocketValid() )
+   if ( !IsSocketValid() || nCount == 0 || pVectors == nullptr )
    {
-      if ( CLOSE( m_socket ) == CSimpleSocket::SocketSuccess )
-      {
-         m_socket = INVALID_SOCKET;
-         bRetVal = true;
-      }
-      TranslateSocketError();
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
    }
-   else
+
+   SetSocketError( SocketSuccess );
+
+   // Stream sockets ignore the destination, datagrams go where Send() would send them
+   const sockaddr_in* pAddr = ( m_nSocketType == SocketTypeUdp ) ? GetUdpTxAddrBuffer() : nullptr;
+   const socklen_t nAddrLen = ( pAddr != nullptr ) ? SOCKET_ADDR_IN_SIZE : 0;
+
+#ifdef _WIN32
+   std::vector<WSABUF> buffers( nCount );
+   for ( size_t i = 0; i < nCount; ++i )
    {
-      SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      buffers[ i ].buf = static_cast<char*>( pVectors[ i ].iov_base );
+      buffers[ i ].len = static_cast<ULONG>( pVectors[ i ].iov_len );
    }
+#else
+   msghdr stMessage = {};
+   stMessage.msg_name = const_cast<sockaddr_in*>( pAddr );
+   stMessage.msg_namelen = nAddrLen;
+   stMessage.msg_iov = const_cast<iovec*>( pVectors );
+   stMessage.msg_iovlen = nCount;
+#endif
 
-   return bRetVal;
-}
+   m_timer.SetStartTime();
 
-//-------------------------------------------------------------------------------------------------
-//
-// Shtudown()
-//
-//-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::Shutdown( CShutdownMode nShutdown )
-{
-   if ( shutdown( m_socket, nShutdown ) == SocketError )
+   // Check error condition and attempt to resend if call was interrupted by a signal.
+   do
    {
+#ifdef _WIN32
+      DWORD nSent = 0;
+      m_nBytesSent = ( WSASendTo( m_socket, buffers.data(), static_cast<DWORD>( nCount ), &nSent, 0,
+                                  reinterpret_cast<const sockaddr*>( pAddr ), nAddrLen, nullptr, nullptr ) == 0 )
+                         ? static_cast<int32_t>( nSent )
+                         : SocketError;
+#else
+      m_nBytesSent = static_cast<int32_t>( SENDMSG( m_socket, &stMessage, 0 ) );
+#endif
       TranslateSocketError();
+   } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
 
-      // Shutdown failed because there was no connection.
-      // This is typically cause by a the remote sending FIN
-      // before the local side has finished.
-      return ( m_error == SocketNotconnected );
-   }
+   m_timer.SetEndTime();
 
-   return true;
+   return m_nBytesSent;
 }
 
 //-------------------------------------------------------------------------------------------------
 //
-// Flush()
+// SendAll() - Send the whole block of data, waiting out partial writes
 //
 //-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::Flush()
+int32_t CSimpleSocket::SendAll( const uint8_t* pBuf, size_t bytesToSend, int32_t nTimeoutMs )
 {
-   if ( !IsSocketValid() )
+   if ( !IsSocketValid() || bytesToSend == 0 || pBuf == nullptr )
    {
-      SetSocketError( SocketInvalidSocket );
-      return false;
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
    }
 
-   if ( m_nSocketType != CSocketType::SocketTypeTcp )
+   if ( m_nSocketType != SocketTypeTcp )
    {
       SetSocketError( SocketProtocolError );
-      return false;
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
    }
 
-   int32_t nCurFlags = 0;
-   socklen_t nLen = sizeof( int32_t );
-
-   // Get the current setting of the TCP_NODELAY flag.
-   bool bRetVal = GETSOCKOPT( m_socket, IPPROTO_TCP, TCP_NODELAY, &nCurFlags, &nLen ) == SocketSuccess;
-
-   if ( bRetVal && !nCurFlags )
+   const bool bSwitchBlocking = ( TRANSFER_DONTWAIT == 0 ) && ( nTimeoutMs >= 0 ) && m_bIsBlocking;
+   if ( bSwitchBlocking && !SetNonblocking() )
    {
-      bRetVal = DisableNagleAlgoritm();   // Set TCP NoDelay flag
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
    }
 
-   if ( bRetVal )
-   {
-      // Send empty byte stream without Nagle to flush the TCP send buffer asap
-      uint8_t tmpbuf = 0;
-      bRetVal = Send( &tmpbuf, sizeof( tmpbuf ) ) != CSimpleSocket::SocketError;
-   }
+   const int32_t nFlags = ( nTimeoutMs >= 0 ) ? TRANSFER_DONTWAIT : 0;
+   const auto start = std::chrono::steady_clock::now();
+   size_t nSent = 0;
 
-   if ( bRetVal && !nCurFlags )
+   SetSocketError( SocketSuccess );
+   m_timer.SetStartTime();
+
+   while ( nSent < bytesToSend )
    {
-      bRetVal = EnableNagleAlgoritm();   // Reset the TCP_NODELAY flag to original state.
+      const auto nResult = SEND( m_socket, ( pBuf + nSent ), bytesToSend - nSent, nFlags );
+      if ( nResult > 0 )
+      {
+         nSent += nResult;
+         continue;
+      }
+
+      TranslateSocketError();
+      if ( GetSocketError() == SocketInterrupted ) continue;
+
+      // A blocking socket without a deadline only stops early on its own send timeout
+      const bool bWait = ( GetSocketError() == SocketEwouldblock ) && ( nTimeoutMs >= 0 || !m_bIsBlocking );
+      if ( !bWait || !WaitForTransfer( ReadinessWritable, nTimeoutMs, start ) ) break;
    }
 
-   if ( !bRetVal ) TranslateSocketError();
+   m_timer.SetEndTime();
+   RestoreBlocking( bSwitchBlocking );
 
-   return bRetVal;
+   m_nBytesSent = ( nSent > 0 || GetSocketError() == SocketSuccess ) ? static_cast<int32_t>( nSent ) : SocketError;
+   return m_nBytesSent;
 }
 
 //-------------------------------------------------------------------------------------------------
 //
-// SetReceiveTimeout()
+// SendBatch()
 //
 //-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::SetReceiveTimeout( int32_t nRecvTimeoutSec, int32_t nRecvTimeoutUsec )
+int32_t CSimpleSocket::SendBatch( CDatagram* pDatagrams, size_t nCount )
 {
-   bool bRetVal = true;
-
-   memset( &m_stRecvTimeout, 0, sizeof( struct timeval ) );
-
-   m_stRecvTimeout.tv_sec = nRecvTimeoutSec;
-   m_stRecvTimeout.tv_usec = nRecvTimeoutUsec;
+   if ( !IsSocketValid() || nCount == 0 || pDatagrams == nullptr )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
 
-   //--------------------------------------------------------------------------
-   // Sanity check to make sure the options are supported!
-   //--------------------------------------------------------------------------
-   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_RCVTIMEO, &m_stRecvTimeout, sizeof( struct timeval ) ) ==
-        CSimpleSocket::SocketError )
+   if ( m_nSocketType != SocketTypeUdp )
    {
-      bRetVal = false;
-      TranslateSocketError();
+      SetSocketError( SocketProtocolError );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
    }
 
-   return bRetVal;
-}
+   SetSocketError( SocketSuccess );
+   m_nBytesSent = 0;
 
-//-------------------------------------------------------------------------------------------------
-//
-// SetSendTimeout()
-//
-//-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::SetSendTimeout( int32_t nSendTimeoutSec, int32_t nSendTimeoutUsec )
-{
-   bool bRetVal = true;
+   size_t nSent = 0;
+
+   m_timer.SetStartTime();
 
-   memset( &m_stSendTimeout, 0, sizeof( timeval ) );
-   m_stSendTimeout.tv_sec = nSendTimeoutSec;
-   m_stSendTimeout.tv_usec = nSendTimeoutUsec;
+#ifdef _LINUX
+   // Headers live on the stack, a batch larger than this is sent in several calls
+   std::array<mmsghdr, BATCH_CHUNK_SIZE> messages;
 
-   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_SNDTIMEO, &m_stSendTimeout, sizeof( timeval ) ) == SocketError )
+   while ( nSent < nCount )
    {
-      bRetVal = false;
-      TranslateSocketError();
-   }
+      const size_t nChunk = std::min( nCount - nSent, messages.size() );
+      for ( size_t i = 0; i < nChunk; ++i )
+      {
+         CDatagram& datagram = pDatagrams[ nSent + i ];
+         const bool bDefault = ( datagram.stAddr.sin_family == AF_UNSPEC );
+
+         messages[ i ] = {};
+         messages[ i ].msg_hdr.msg_name = bDefault ? GetUdpTxAddrBuffer() : &datagram.stAddr;
+         messages[ i ].msg_hdr.msg_namelen = SOCKET_ADDR_IN_SIZE;
+         messages[ i ].msg_hdr.msg_iov = &datagram.stBuffer;
+         messages[ i ].msg_hdr.msg_iovlen = 1;
+      }
 
-   return bRetVal;
-}
+      int nResult = 0;
+      do
+      {
+         nResult = sendmmsg( m_socket, messages.data(), static_cast<unsigned int>( nChunk ), 0 );
+         TranslateSocketError();
+      } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
 
-//-------------------------------------------------------------------------------------------------
-//
-// SetOptionReuseAddr()
-//
-//-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::SetOptionReuseAddr()
-{
-   int32_t nReuse = IPTOS_LOWDELAY;
-   bool bRetVal = ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_REUSEADDR, &nReuse, sizeof( int32_t ) ) == SocketSuccess );
+      if ( nResult == SocketError )
+      {
+         break;
+      }
 
-   if ( bRetVal && m_nSocketType == SocketTypeTcp )
-   {
-      bRetVal = ( SETSOCKOPT( m_socket, IPPROTO_TCP, IP_TOS, &nReuse, sizeof( int32_t ) ) == SocketSuccess );
+      for ( int i = 0; i < nResult; ++i )
+      {
+         pDatagrams[ nSent + i ].nLength = messages[ i ].msg_len;
+         m_nBytesSent += static_cast<int32_t>( messages[ i ].msg_len );
+      }
+
+      nSent += static_cast<size_t>( nResult );
+      if ( static_cast<size_t>( nResult ) < nChunk )
+      {
+         break;
+      }
    }
-   TranslateSocketError();
+#else
+   for ( ; nSent < nCount; ++nSent )
+   {
+      CDatagram& datagram = pDatagrams[ nSent ];
+      const sockaddr_in* pAddr = ( datagram.stAddr.sin_family == AF_UNSPEC ) ? GetUdpTxAddrBuffer() : &datagram.stAddr;
 
-   return bRetVal;
-}
+      int32_t nResult = 0;
+      do
+      {
+         nResult = SENDTO( m_socket, datagram.stBuffer.iov_base, datagram.stBuffer.iov_len, 0,
+                           reinterpret_cast<const sockaddr*>( pAddr ), SOCKET_ADDR_IN_SIZE );
+         TranslateSocketError();
+      } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
 
-//-------------------------------------------------------------------------------------------------
-void CSimpleSocket::SetConnectTimeout( int32_t nConnectTimeoutSec, int32_t nConnectTimeoutUsec )
-{
-   m_stConnectTimeout.tv_sec = nConnectTimeoutSec;
-   m_stConnectTimeout.tv_usec = nConnectTimeoutUsec;
-}
+      if ( nResult == SocketError )
+      {
+         break;
+      }
 
-//-------------------------------------------------------------------------------------------------
-//
-// SetOptionLinger()
-//
-//-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::SetOptionLinger( bool bEnable, uint16_t nTime )
-{
-   bool bRetVal = false;
+      datagram.nLength = static_cast<uint32_t>( nResult );
+      m_nBytesSent += nResult;
+   }
+#endif
 
-   m_stLinger.l_onoff = ( bEnable ) ? 1 : 0;
-   m_stLinger.l_linger = nTime;
+   m_timer.SetEndTime();
 
-   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_LINGER, &m_stLinger, sizeof( m_stLinger ) ) == SocketSuccess )
+   // Report the datagrams which made it out, the error stays set for the one which did not
+   if ( nSent == 0 )
    {
-      bRetVal = true;
+      m_nBytesSent = SocketError;
+      return SocketError;
    }
 
-   TranslateSocketError();
-
-   return bRetVal;
+   return static_cast<int32_t>( nSent );
 }
 
 //-------------------------------------------------------------------------------------------------
-int32_t CSimpleSocket::Receive( uint32_t nMaxBytes, uint8_t* pBuffer )
+//
+// ReceiveBatch()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::ReceiveBatch( CDatagram* pDatagrams, size_t nCount )
 {
-   if ( !IsSocketValid() )
+   if ( !IsSocketValid() || nCount == 0 || pDatagrams == nullptr )
    {
-      SetSocketError( SocketInvalidSocket );
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
       m_nBytesReceived = SocketError;
       return m_nBytesReceived;
    }
 
-   if ( nMaxBytes == 0 )
+   if ( m_nSocketType != SocketTypeUdp )
    {
-      m_nBytesReceived = nMaxBytes;
+      SetSocketError( SocketProtocolError );
+      m_nBytesReceived = SocketError;
       return m_nBytesReceived;
    }
 
-   uint8_t* pWorkBuffer = pBuffer;
+   SetSocketError( SocketSuccess );
+   m_nBytesReceived = 0;
+
+   int32_t nReceived = 0;
+
+   m_timer.SetStartTime();
+
+#ifdef _LINUX
+   std::array<mmsghdr, BATCH_CHUNK_SIZE> messages;
+   const size_t nChunk = std::min( nCount, messages.size() );
+   for ( size_t i = 0; i < nChunk; ++i )
+   {
+      messages[ i ] = {};
+      messages[ i ].msg_hdr.msg_name = &pDatagrams[ i ].stAddr;
+      messages[ i ].msg_hdr.msg_namelen = SOCKET_ADDR_IN_SIZE;
+      messages[ i ].msg_hdr.msg_iov = &pDatagrams[ i ].stBuffer;
+      messages[ i ].msg_hdr.msg_iovlen = 1;
+   }
+
+   // Block for the first datagram only, then take whatever else is already queued
+   do
+   {
+      nReceived = recvmmsg( m_socket, messages.data(), static_cast<unsigned int>( nChunk ), MSG_WAITFORONE, nullptr );
+      TranslateSocketError();
+   } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
+
+   for ( int32_t i = 0; i < nReceived; ++i )
+   {
+      pDatagrams[ i ].nLength = messages[ i ].msg_len;
+      m_nBytesReceived += static_cast<int32_t>( messages[ i ].msg_len );
+   }
+#else
+   // Without recvmmsg() only the datagram which is waited for is taken
+   CDatagram& datagram = pDatagrams[ 0 ];
+   socklen_t nAddrLen = SOCKET_ADDR_IN_SIZE;
+   do
+   {
+      nReceived = RECVFROM( m_socket, datagram.stBuffer.iov_base, datagram.stBuffer.iov_len, 0, &datagram.stAddr,
+                            &nAddrLen );
+      TranslateSocketError();
+   } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
+
+   if ( nReceived != SocketError )
+   {
+      datagram.nLength = static_cast<uint32_t>( nReceived );
+      m_nBytesReceived = nReceived;
+      nReceived = 1;
+   }
+#endif
+
+   m_timer.SetEndTime();
+
+   if ( nReceived == SocketError )
+   {
+      m_nBytesReceived = SocketError;
+   }
+   else if ( nReceived > 0 )
+   {
+      *GetUdpRxAddrBuffer() = pDatagrams[ nReceived - 1 ].stAddr;   // Replies go to the latest sender, as with Receive()
+   }
+
+   return nReceived;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SendSegmented()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::SendSegmented( const uint8_t* pBuf, size_t bytesToSend, uint16_t nSegmentSize )
+{
+   if ( !IsSocketValid() || bytesToSend == 0 || pBuf == nullptr || nSegmentSize == 0 )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
+
+   if ( m_nSocketType != SocketTypeUdp )
+   {
+      SetSocketError( SocketProtocolError );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
+
+#if defined( _LINUX ) && defined( UDP_SEGMENT )
+   // Each send may only carry so many segments, and no more than a datagram's worth of bytes
+   const size_t nSegmentsPerSend = std::min( MAX_GSO_SEGMENTS, MAX_UDP_PAYLOAD / nSegmentSize );
+   if ( nSegmentsPerSend < 2 )
+   {
+      return SendSegmentedBatch( pBuf, bytesToSend, nSegmentSize );
+   }
+
+   std::array<char, CMSG_SPACE( sizeof( uint16_t ) )> control{};
+   iovec stBuffer = {};
+   msghdr stMessage = {};
+   stMessage.msg_name = GetUdpTxAddrBuffer();
+   stMessage.msg_namelen = SOCKET_ADDR_IN_SIZE;
+   stMessage.msg_iov = &stBuffer;
+   stMessage.msg_iovlen = 1;
+
+   SetSocketError( SocketSuccess );
+   m_nBytesSent = 0;
+
+   m_timer.SetStartTime();
+
+   size_t nOffset = 0;
+   while ( nOffset < bytesToSend )
+   {
+      const size_t nLength = std::min( bytesToSend - nOffset, nSegmentsPerSend * nSegmentSize );
+      stBuffer = { const_cast<uint8_t*>( pBuf + nOffset ), nLength };
+
+      // The segment size travels as a control message, a lone segment does not need one
+      stMessage.msg_control = ( nLength > nSegmentSize ) ? control.data() : nullptr;
+      stMessage.msg_controllen = ( nLength > nSegmentSize ) ? control.size() : 0;
+      if ( stMessage.msg_control != nullptr )
+      {
+         cmsghdr* pHeader = CMSG_FIRSTHDR( &stMessage );
+         pHeader->cmsg_level = SOL_UDP;
+         pHeader->cmsg_type = UDP_SEGMENT;
+         pHeader->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+         std::memcpy( CMSG_DATA( pHeader ), &nSegmentSize, sizeof( uint16_t ) );
+      }
+
+      ssize_t nResult = 0;
+      do
+      {
+         nResult = SENDMSG( m_socket, &stMessage, 0 );
+      } while ( nResult == SocketError && errno == EINTR );
+
+      if ( nResult == SocketError )
+      {
+         // Older kernels reject the option, and devices without checksum offload refuse to segment
+         if ( errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP )
+         {
+            m_timer.SetEndTime();
+            const int32_t nRemaining = SendSegmentedBatch( pBuf + nOffset, bytesToSend - nOffset, nSegmentSize );
+            if ( nRemaining != SocketError )
+            {
+               m_nBytesSent = static_cast<int32_t>( nOffset ) + nRemaining;
+            }
+            else if ( nOffset > 0 )
+            {
+               m_nBytesSent = static_cast<int32_t>( nOffset );
+            }
+
+            return m_nBytesSent;
+         }
+
+         TranslateSocketError();
+         break;
+      }
+
+      nOffset += static_cast<size_t>( nResult );
+   }
+
+   m_timer.SetEndTime();
+
+   m_nBytesSent = ( nOffset > 0 ) ? static_cast<int32_t>( nOffset ) : SocketError;
+   return m_nBytesSent;
+#else
+   return SendSegmentedBatch( pBuf, bytesToSend, nSegmentSize );
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::SendSegmentedBatch( const uint8_t* pBuf, size_t bytesToSend, uint16_t nSegmentSize )
+{
+   std::array<CDatagram, BATCH_CHUNK_SIZE> datagrams;
+   int32_t nTotal = 0;
+
+   for ( size_t nOffset = 0; nOffset < bytesToSend; )
+   {
+      size_t nCount = 0;
+      for ( ; nCount < datagrams.size() && nOffset < bytesToSend; ++nCount )
+      {
+         const size_t nLength = std::min<size_t>( bytesToSend - nOffset, nSegmentSize );
+         datagrams[ nCount ].stBuffer = { const_cast<uint8_t*>( pBuf + nOffset ), nLength };
+         nOffset += nLength;
+      }
+
+      const int32_t nSent = SendBatch( datagrams.data(), nCount );
+      if ( nSent == SocketError )
+      {
+         break;
+      }
+
+      nTotal += m_nBytesSent;
+      if ( static_cast<size_t>( nSent ) < nCount )
+      {
+         break;
+      }
+   }
+
+   m_nBytesSent = ( nTotal > 0 ) ? nTotal : SocketError;
+   return m_nBytesSent;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SendFile() - Send the contents of a file without copying it through userspace
+//
+//-------------------------------------------------------------------------------------------------
+int64_t CSimpleSocket::SendFile( int nFile, off_t nOffset, size_t nCount )
+{
+   if ( !IsSocketValid() || nFile < 0 || nCount == 0 || nOffset < 0 )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidOperation : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return SocketError;
+   }
+
+   SetSocketError( SocketSuccess );
+
+   int64_t nTotal = 0;
+
+#if !defined( _LINUX ) && !defined( _DARWIN )
+   // The fallback reads from the current position, put it back afterwards as documented
+   const long nSavedPosition = SEEK( nFile, 0, SEEK_CUR );
+#endif
+
+   m_timer.SetStartTime();
+
+   // The kernel may stop short of the request, keep going until everything is out or the socket
+   // would block, in which case the caller resumes from the returned count.
+   while ( static_cast<size_t>( nTotal ) < nCount )
+   {
+      const size_t nRemaining = nCount - static_cast<size_t>( nTotal );
+      int64_t nSent = 0;
+
+#ifdef _LINUX
+      off_t nPosition = nOffset + static_cast<off_t>( nTotal );
+      nSent = SENDFILE( m_socket, nFile, &nPosition, nRemaining );
+#elif defined( _DARWIN )
+      // An interrupted or would block call still reports what it sent, which must not be sent again
+      off_t nLength = static_cast<off_t>( nRemaining );
+      nSent = ( sendfile( nFile, m_socket, nOffset + nTotal, &nLength, nullptr, 0 ) == SocketSuccess ||
+                ( ( errno == EAGAIN || errno == EINTR ) && nLength > 0 ) )
+                  ? nLength
+                  : SocketError;
+#else
+      // No zero copy path, stage the file through a buffer instead
+      std::array<uint8_t, 64 * 1024> buffer;
+      if ( SEEK( nFile, static_cast<long>( nOffset + nTotal ), SEEK_SET ) == SocketError )
+      {
+         nSent = SocketError;
+      }
+      else
+      {
+         const int nRead = READ( nFile, buffer.data(), static_cast<unsigned int>( std::min( nRemaining, buffer.size() ) ) );
+         nSent = ( nRead > 0 ) ? SEND( m_socket, buffer.data(), nRead, 0 ) : nRead;
+      }
+#endif
+
+      if ( nSent == SocketError )
+      {
+         TranslateSocketError();
+         if ( GetSocketError() == SocketInterrupted )
+         {
+            continue;
+         }
+
+         break;   // Error or would block
+      }
+
+      if ( nSent == 0 )
+      {
+         break;   // End of file
+      }
+
+      nTotal += nSent;
+   }
+
+#if !defined( _LINUX ) && !defined( _DARWIN )
+   if ( nSavedPosition >= 0 )
+   {
+      SEEK( nFile, nSavedPosition, SEEK_SET );
+   }
+#endif
+
+   m_timer.SetEndTime();
+
+   if ( nTotal > 0 )
+   {
+      // The transfer made progress, report it even if it stopped on would block
+      if ( static_cast<size_t>( nTotal ) == nCount ) SetSocketError( SocketSuccess );
+      m_nBytesSent = static_cast<int32_t>( std::min<int64_t>( nTotal, INT32_MAX ) );
+      return nTotal;
+   }
+
+   m_nBytesSent = SocketError;
+   return SocketError;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SetZeroCopy()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetZeroCopy( bool bEnable )
+{
+#if defined( _LINUX ) && defined( SO_ZEROCOPY )
+   const int32_t nEnable = bEnable ? 1 : 0;
+   const bool bRetVal = ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_ZEROCOPY, &nEnable, sizeof( nEnable ) ) == SocketSuccess );
+   TranslateSocketError();
+
+   if ( bRetVal )
+   {
+      m_bZeroCopy = bEnable;
+   }
+
+   return bRetVal;
+#else
+   SetSocketError( bEnable ? CSimpleSocket::SocketProtocolError : CSimpleSocket::SocketSuccess );
+   return !bEnable;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SendZeroCopy()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::SendZeroCopy( const uint8_t* pBuf, size_t bytesToSend, uint32_t& nId )
+{
+   if ( !IsSocketValid() || bytesToSend == 0 || pBuf == nullptr )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
+
+   // Without the option the kernel silently copies and never notifies, the caller would wait forever
+   if ( !m_bZeroCopy )
+   {
+      SetSocketError( SocketInvalidOperation );
+      m_nBytesSent = SocketError;
+      return m_nBytesSent;
+   }
+
+#if defined( _LINUX ) && defined( MSG_ZEROCOPY )
+   SetSocketError( SocketSuccess );
+
+   const sockaddr* pAddr =
+       ( m_nSocketType == SocketTypeUdp ) ? reinterpret_cast<const sockaddr*>( GetUdpTxAddrBuffer() ) : nullptr;
+   const socklen_t nAddrLen = ( pAddr != nullptr ) ? SOCKET_ADDR_IN_SIZE : 0;
+
+   m_timer.SetStartTime();
+
+   do
+   {
+      m_nBytesSent = SENDTO( m_socket, pBuf, bytesToSend, MSG_ZEROCOPY, pAddr, nAddrLen );
+      TranslateSocketError();
+   } while ( GetSocketError() == CSimpleSocket::SocketInterrupted );
+
+   m_timer.SetEndTime();
+
+   // The kernel numbers every call which sent something, mirror it to hand out the identifier
+   if ( m_nBytesSent != SocketError )
+   {
+      nId = m_nZeroCopyNext++;
+   }
+
+   return m_nBytesSent;
+#else
+   (void)nId;
+   SetSocketError( SocketProtocolError );
+   m_nBytesSent = SocketError;
+   return m_nBytesSent;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// ReapZeroCopyCompletions()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::ReapZeroCopyCompletions( std::vector<CZeroCopyCompletion>& completions )
+{
+   if ( !IsSocketValid() )
+   {
+      SetSocketError( SocketInvalidSocket );
+      return SocketError;
+   }
+
+   SetSocketError( SocketSuccess );
+
+#if defined( _LINUX ) && defined( SO_EE_ORIGIN_ZEROCOPY )
+   int32_t nReaped = 0;
+
+   for ( ;; )
+   {
+      std::array<char, CMSG_SPACE( sizeof( sock_extended_err ) + sizeof( sockaddr_in ) )> control{};
+      msghdr stMessage = {};
+      stMessage.msg_control = control.data();
+      stMessage.msg_controllen = control.size();
+
+      if ( RECVMSG( m_socket, &stMessage, MSG_ERRQUEUE | MSG_DONTWAIT ) == SocketError )
+      {
+         if ( errno == EINTR ) continue;
+         if ( errno == EAGAIN ) break;   // Queue is empty
+
+         TranslateSocketError();
+         return SocketError;
+      }
+
+      for ( cmsghdr* pHeader = CMSG_FIRSTHDR( &stMessage ); pHeader != nullptr;
+            pHeader = CMSG_NXTHDR( &stMessage, pHeader ) )
+      {
+         if ( !( pHeader->cmsg_level == SOL_IP && pHeader->cmsg_type == IP_RECVERR ) &&
+              !( pHeader->cmsg_level == SOL_IPV6 && pHeader->cmsg_type == IPV6_RECVERR ) )
+         {
+            continue;
+         }
+
+         sock_extended_err stError = {};
+         std::memcpy( &stError, CMSG_DATA( pHeader ), sizeof( stError ) );
+         if ( stError.ee_errno != 0 || stError.ee_origin != SO_EE_ORIGIN_ZEROCOPY )
+         {
+            continue;   // Some other error report, not a release notification
+         }
+
+         completions.push_back(
+             { stError.ee_info, stError.ee_data, ( stError.ee_code & SO_EE_CODE_ZEROCOPY_COPIED ) != 0 } );
+         ++nReaped;
+      }
+   }
+
+   return nReaped;
+#else
+   (void)completions;
+   return 0;
+#endif
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Close() - Close socket and free up any memory allocated for the socket
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Close()
+{
+   bool bRetVal = false;
+
+   // if socket handle is currently valid, close and then invalidate
+   if ( IsSocketValid() )
+   {
+      if ( CLOSE( m_socket ) == CSimpleSocket::SocketSuccess )
+      {
+         m_socket = INVALID_SOCKET;
+         bRetVal = true;
+      }
+      TranslateSocketError();
+   }
+   else
+   {
+      SetSocketError( CSimpleSocket::SocketInvalidSocket );
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Shtudown()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Shutdown( CShutdownMode nShutdown )
+{
+   if ( shutdown( m_socket, nShutdown ) == SocketError )
+   {
+      TranslateSocketError();
+
+      // Shutdown failed because there was no connection.
+      // This is typically cause by a the remote sending FIN
+      // before the local side has finished.
+      return ( m_error == SocketNotconnected );
+   }
+
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Flush()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Flush()
+{
+   if ( !IsSocketValid() )
+   {
+      SetSocketError( SocketInvalidSocket );
+      return false;
+   }
+
+   if ( m_nSocketType != CSocketType::SocketTypeTcp )
+   {
+      SetSocketError( SocketProtocolError );
+      return false;
+   }
+
+   // Removing the cork transmits whatever it held back
+   if ( m_bIsCorked )
+   {
+      return SetCorked( false ) && SetCorked( true );
+   }
+
+   int32_t nCurFlags = 0;
+   socklen_t nLen = sizeof( int32_t );
+
+   // Get the current setting of the TCP_NODELAY flag so it can be restored
+   bool bRetVal = GETSOCKOPT( m_socket, IPPROTO_TCP, TCP_NODELAY, &nCurFlags, &nLen ) == SocketSuccess;
+   TranslateSocketError();
+
+   if ( bRetVal )
+   {
+      // Setting TCP_NODELAY transmits any pending segments, even when it is already set, which
+      // also pushes out data held back by SendMore. Then reset it to the original state.
+      bRetVal = DisableNagleAlgoritm() && ( nCurFlags != 0 || EnableNagleAlgoritm() );
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Cork() / Uncork()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Cork()
+{
+   return SetCorked( true );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Uncork()
+{
+   return SetCorked( false );
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetCorked( bool bCorked )
+{
+   if ( !IsSocketValid() )
+   {
+      SetSocketError( SocketInvalidSocket );
+      return false;
+   }
+
+   if ( m_nSocketType != CSocketType::SocketTypeTcp )
+   {
+      SetSocketError( SocketProtocolError );
+      return false;
+   }
+
+#if defined( TCP_CORK )
+   const int32_t nCork = bCorked ? 1 : 0;
+   const bool bRetVal = SETSOCKOPT( m_socket, IPPROTO_TCP, TCP_CORK, &nCork, sizeof( int32_t ) ) == SocketSuccess;
+   TranslateSocketError();
+#elif defined( TCP_NOPUSH )
+   const int32_t nCork = bCorked ? 1 : 0;
+   const bool bRetVal = SETSOCKOPT( m_socket, IPPROTO_TCP, TCP_NOPUSH, &nCork, sizeof( int32_t ) ) == SocketSuccess;
+   TranslateSocketError();
+#else
+   const bool bRetVal = false;
+   SetSocketError( SocketProtocolError );
+#endif
+
+   if ( bRetVal ) m_bIsCorked = bCorked;
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SetReceiveTimeout()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetReceiveTimeout( int32_t nRecvTimeoutSec, int32_t nRecvTimeoutUsec )
+{
+   bool bRetVal = true;
+
+   timeval& stRecvTimeout = GetMutableSettings().stRecvTimeout;
+   stRecvTimeout.tv_sec = nRecvTimeoutSec;
+   stRecvTimeout.tv_usec = nRecvTimeoutUsec;
+
+   //--------------------------------------------------------------------------
+   // Sanity check to make sure the options are supported!
+   //--------------------------------------------------------------------------
+   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_RCVTIMEO, &stRecvTimeout, sizeof( struct timeval ) ) ==
+        CSimpleSocket::SocketError )
+   {
+      bRetVal = false;
+      TranslateSocketError();
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SetSendTimeout()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetSendTimeout( int32_t nSendTimeoutSec, int32_t nSendTimeoutUsec )
+{
+   bool bRetVal = true;
+
+   timeval& stSendTimeout = GetMutableSettings().stSendTimeout;
+   stSendTimeout.tv_sec = nSendTimeoutSec;
+   stSendTimeout.tv_usec = nSendTimeoutUsec;
+
+   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_SNDTIMEO, &stSendTimeout, sizeof( timeval ) ) == SocketError )
+   {
+      bRetVal = false;
+      TranslateSocketError();
+   }
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SetOptionReuseAddr()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetOptionReuseAddr()
+{
+   int32_t nReuse = IPTOS_LOWDELAY;
+   bool bRetVal = ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_REUSEADDR, &nReuse, sizeof( int32_t ) ) == SocketSuccess );
+
+   if ( bRetVal && m_nSocketType == SocketTypeTcp )
+   {
+      bRetVal = ( SETSOCKOPT( m_socket, IPPROTO_TCP, IP_TOS, &nReuse, sizeof( int32_t ) ) == SocketSuccess );
+   }
+   TranslateSocketError();
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+void CSimpleSocket::SetConnectTimeout( int32_t nConnectTimeoutSec, int32_t nConnectTimeoutUsec )
+{
+   timeval& stConnectTimeout = GetMutableSettings().stConnectTimeout;
+   stConnectTimeout.tv_sec = nConnectTimeoutSec;
+   stConnectTimeout.tv_usec = nConnectTimeoutUsec;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// SetOptionLinger()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::SetOptionLinger( bool bEnable, uint16_t nTime )
+{
+   bool bRetVal = false;
+
+   linger stLinger = {};
+   stLinger.l_onoff = ( bEnable ) ? 1 : 0;
+   stLinger.l_linger = nTime;
+
+   if ( SETSOCKOPT( m_socket, SOL_SOCKET, SO_LINGER, &stLinger, sizeof( stLinger ) ) == SocketSuccess )
+   {
+      bRetVal = true;
+   }
+
+   TranslateSocketError();
+
+   return bRetVal;
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::Receive( uint32_t nMaxBytes, uint8_t* pBuffer )
+{
+   if ( !IsSocketValid() )
+   {
+      SetSocketError( SocketInvalidSocket );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   if ( nMaxBytes == 0 )
+   {
+      m_nBytesReceived = nMaxBytes;
+      return m_nBytesReceived;
+   }
+
+   if ( m_nSocketType != SocketTypeTcp && m_nSocketType != SocketTypeUdp )
+   {
+      SetSocketError( SocketProtocolError );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   uint8_t* pWorkBuffer = ( pBuffer == nullptr ) ? PrepareBuffer( nMaxBytes ) : pBuffer;
+
+   SetSocketError( SocketSuccess );
+
+   sockaddr_in* pSource = ( m_nSocketType == SocketTypeUdp ) ? GetUdpRxAddrBuffer() : nullptr;
+
+   m_timer.SetStartTime();
+
+   do
+   {
+      socklen_t nSourceSize = SOCKET_ADDR_IN_SIZE;
+      m_nBytesReceived = ( pSource == nullptr )
+                             ? RECV( m_socket, pWorkBuffer, nMaxBytes, m_nFlags )
+                             : RECVFROM( m_socket, pWorkBuffer, nMaxBytes, 0, pSource, &nSourceSize );
+      TranslateSocketError();
+   } while ( GetSocketError() == SocketInterrupted );
+
+   m_timer.SetEndTime();
+
+   if ( m_nBytesReceived == SocketError )
+   {
+      // Clear the output buffer
+      if ( pBuffer == nullptr )
+      {
+         m_pBuffer[ 0 ] = '\0';
+      }
+      else
+      {
+         pBuffer[ 0 ] = '\0';
+      }
+   }
+   else if ( pBuffer == nullptr )
+   {
+      m_nBufferLength = static_cast<uint32_t>( m_nBytesReceived );
+      m_pBuffer[ m_nBufferLength ] = '\0';   // Keeps GetData().c_str() valid
+   }
+
+   return m_nBytesReceived;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// TrySend()
+//
+//-------------------------------------------------------------------------------------------------
+CSimpleSocket::CTransfer CSimpleSocket::TrySend( const uint8_t* pBuf, size_t bytesToSend, uint32_t nSendFlags )
+{
+   if ( !IsSocketValid() )
+   {
+      return { SocketError, SocketInvalidSocket };
+   }
+
+   if ( pBuf == nullptr || bytesToSend == 0 )
+   {
+      return { SocketError, SocketInvalidPointer };
+   }
+
+   int32_t nFlags = 0;
+#ifdef MSG_MORE
+   if ( nSendFlags & SendMore ) nFlags |= MSG_MORE;
+#endif
+
+   // Only read here, another thread may be receiving on this socket
+   const auto addrToSentTo =
+       ( m_nSocketType == SocketTypeUdp ) ? reinterpret_cast<const sockaddr*>( GetUdpTxAddr() ) : nullptr;
+
+   while ( true )
+   {
+      const int32_t nSent = ( addrToSentTo == nullptr )
+                                ? SEND( m_socket, pBuf, bytesToSend, nFlags )
+                                : SENDTO( m_socket, pBuf, bytesToSend, nFlags, addrToSentTo, SOCKET_ADDR_IN_SIZE );
+      if ( nSent >= 0 )
+      {
+         return { nSent, SocketSuccess };
+      }
+
+      const CSocketError error = GetLastSystemError();
+      if ( error != SocketInterrupted )
+      {
+         return { SocketError, error };
+      }
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// TryReceive()
+//
+//-------------------------------------------------------------------------------------------------
+CSimpleSocket::CTransfer CSimpleSocket::TryReceive( uint8_t* pBuffer, uint32_t nMaxBytes, sockaddr_in* pSource )
+{
+   if ( !IsSocketValid() )
+   {
+      return { SocketError, SocketInvalidSocket };
+   }
+
+   // Nothing received would be indistinguishable from the remote closing the connection
+   if ( pBuffer == nullptr || nMaxBytes == 0 )
+   {
+      return { SocketError, SocketInvalidPointer };
+   }
+
+   while ( true )
+   {
+      socklen_t nSourceSize = SOCKET_ADDR_IN_SIZE;
+      const int32_t nReceived = ( pSource == nullptr )
+                                    ? RECV( m_socket, pBuffer, nMaxBytes, m_nFlags )
+                                    : RECVFROM( m_socket, pBuffer, nMaxBytes, 0, pSource, &nSourceSize );
+      if ( nReceived >= 0 )
+      {
+         return { nReceived, SocketSuccess };
+      }
+
+      const CSocketError error = GetLastSystemError();
+      if ( error != SocketInterrupted )
+      {
+         return { SocketError, error };
+      }
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// ReceiveExactly() - Receive a whole block of data, waiting out partial reads
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::ReceiveExactly( uint8_t* pBuffer, uint32_t nBytes, int32_t nTimeoutMs )
+{
+   if ( !IsSocketValid() )
+   {
+      SetSocketError( SocketInvalidSocket );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   if ( m_nSocketType != SocketTypeTcp )
+   {
+      SetSocketError( SocketProtocolError );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   if ( nBytes == 0 )
+   {
+      m_nBytesReceived = 0;
+      return m_nBytesReceived;
+   }
+
+   uint8_t* pWorkBuffer = ( pBuffer == nullptr ) ? PrepareBuffer( nBytes ) : pBuffer;
+
+   // MSG_WAITALL only returns early on a signal, an error or the end of the stream
+   const bool bSwitchBlocking = ( TRANSFER_DONTWAIT == 0 ) && ( nTimeoutMs >= 0 ) && m_bIsBlocking;
+   if ( bSwitchBlocking && !SetNonblocking() )
+   {
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   const int32_t nFlags = ( nTimeoutMs >= 0 ) ? TRANSFER_DONTWAIT : RECV_FLAGS;
+   const auto start = std::chrono::steady_clock::now();
+   uint32_t nReceived = 0;
+
+   SetSocketError( SocketSuccess );
+   m_timer.SetStartTime();
+
+   while ( nReceived < nBytes )
+   {
+      const auto nResult = RECV( m_socket, ( pWorkBuffer + nReceived ), nBytes - nReceived, nFlags );
+      if ( nResult > 0 )
+      {
+         nReceived += nResult;
+         continue;
+      }
+
+      if ( nResult == 0 )
+      {
+         SetSocketError( SocketSuccess );   // Remote closed the connection
+         break;
+      }
+
+      TranslateSocketError();
+      if ( GetSocketError() == SocketInterrupted ) continue;
+
+      // A blocking socket without a deadline only stops early on its own receive timeout
+      const bool bWait = ( GetSocketError() == SocketEwouldblock ) && ( nTimeoutMs >= 0 || !m_bIsBlocking );
+      if ( !bWait || !WaitForTransfer( ReadinessReadable, nTimeoutMs, start ) ) break;
+   }
+
+   m_timer.SetEndTime();
+   RestoreBlocking( bSwitchBlocking );
+
    if ( pBuffer == nullptr )
    {
-      m_sBuffer.assign( nMaxBytes, '\0' );
-      pWorkBuffer = reinterpret_cast<uint8_t*>( &m_sBuffer[ 0 ] );   // Use string's internal memory as the buffer
+      m_nBufferLength = nReceived;
+      m_pBuffer[ m_nBufferLength ] = '\0';
+   }
+
+   m_nBytesReceived = ( nReceived > 0 || GetSocketError() == SocketSuccess ) ? static_cast<int32_t>( nReceived ) : SocketError;
+   return m_nBytesReceived;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint8_t* CSimpleSocket::PrepareBuffer( uint32_t nMaxBytes )
+{
+   if ( nMaxBytes > m_nBufferCapacity )
+   {
+      // The previous contents are about to be overwritten so they are not kept, and the new
+      // memory is left uninitialized rather than zero filled
+      m_pBuffer.reset( new char[ nMaxBytes + 1 ] );
+      m_nBufferCapacity = nMaxBytes;
+   }
+
+   m_nBufferLength = 0;
+   return reinterpret_cast<uint8_t*>( m_pBuffer.get() );
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::Receive( iovec* pVectors, size_t nCount )
+{
+   if ( !IsSocketValid() || nCount == 0 || pVectors == nullptr )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
    }
 
    SetSocketError( SocketSuccess );
-   m_nBytesReceived = 0;
 
-   std::function<int32_t()> receivePacket = [] { return -1; };
-   if ( m_nSocketType == SocketTypeTcp )
-      receivePacket = [&] { return RECV( m_socket, ( pWorkBuffer + m_nBytesReceived ), nMaxBytes, m_nFlags ); };
-   if ( m_nSocketType == SocketTypeUdp )
-      receivePacket = [&] {
-         uint32_t srcSize = SOCKET_ADDR_IN_SIZE;
-         return RECVFROM( m_socket, ( pWorkBuffer + m_nBytesReceived ), nMaxBytes, 0, GetUdpRxAddrBuffer(), &srcSize );
-      };
+   sockaddr_in* pAddr = ( m_nSocketType == SocketTypeUdp ) ? GetUdpRxAddrBuffer() : nullptr;
+   socklen_t nAddrLen = ( pAddr != nullptr ) ? SOCKET_ADDR_IN_SIZE : 0;
+   const uint32_t nFlags = ( m_nSocketType == SocketTypeTcp ) ? m_nFlags : 0;
+
+#ifdef _WIN32
+   std::vector<WSABUF> buffers( nCount );
+   for ( size_t i = 0; i < nCount; ++i )
+   {
+      buffers[ i ].buf = static_cast<char*>( pVectors[ i ].iov_base );
+      buffers[ i ].len = static_cast<ULONG>( pVectors[ i ].iov_len );
+   }
+#else
+   msghdr stMessage = {};
+   stMessage.msg_name = pAddr;
+   stMessage.msg_namelen = nAddrLen;
+   stMessage.msg_iov = pVectors;
+   stMessage.msg_iovlen = nCount;
+#endif
+
+   m_timer.SetStartTime();
+
+   do
+   {
+#ifdef _WIN32
+      DWORD nReceived = 0;
+      DWORD nWinFlags = nFlags;
+      m_nBytesReceived = ( WSARecvFrom( m_socket, buffers.data(), static_cast<DWORD>( nCount ), &nReceived, &nWinFlags,
+                                        reinterpret_cast<sockaddr*>( pAddr ), pAddr ? &nAddrLen : nullptr, nullptr,
+                                        nullptr ) == 0 )
+                             ? static_cast<int32_t>( nReceived )
+                             : SocketError;
+#else
+      m_nBytesReceived = static_cast<int32_t>( RECVMSG( m_socket, &stMessage, static_cast<int>( nFlags ) ) );
+#endif
+      TranslateSocketError();
+   } while ( GetSocketError() == SocketInterrupted );
+
+   m_timer.SetEndTime();
+
+   return m_nBytesReceived;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// ReceiveCoalesced()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSimpleSocket::ReceiveCoalesced( uint8_t* pBuffer, uint32_t nMaxBytes, uint16_t& nSegmentSize )
+{
+   nSegmentSize = 0;
+
+#if defined( _LINUX ) && defined( UDP_GRO )
+   if ( !IsSocketValid() || pBuffer == nullptr || nMaxBytes == 0 )
+   {
+      SetSocketError( IsSocketValid() ? SocketInvalidPointer : SocketInvalidSocket );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   if ( m_nSocketType != SocketTypeUdp )
+   {
+      SetSocketError( SocketProtocolError );
+      m_nBytesReceived = SocketError;
+      return m_nBytesReceived;
+   }
+
+   SetSocketError( SocketSuccess );
+
+   std::array<char, CMSG_SPACE( sizeof( int ) )> control{};
+   iovec stBuffer = { pBuffer, nMaxBytes };
+   msghdr stMessage = {};
+   stMessage.msg_name = GetUdpRxAddrBuffer();
+   stMessage.msg_namelen = SOCKET_ADDR_IN_SIZE;
+   stMessage.msg_iov = &stBuffer;
+   stMessage.msg_iovlen = 1;
+   stMessage.msg_control = control.data();
+   stMessage.msg_controllen = control.size();
 
    m_timer.SetStartTime();
 
    do
    {
-      m_nBytesReceived += receivePacket();
+      m_nBytesReceived = static_cast<int32_t>( RECVMSG( m_socket, &stMessage, 0 ) );
       TranslateSocketError();
    } while ( GetSocketError() == SocketInterrupted );
 
@@ -766,22 +1895,29 @@ int32_t CSimpleSocket::Receive( uint32_t nMaxBytes, uint8_t* pBuffer )
 
    if ( m_nBytesReceived == SocketError )
    {
-      // Clear the output buffer
-      if ( pBuffer == nullptr )
-      {
-         m_sBuffer.clear();
-      }
-      else
-      {
-         pBuffer[ 0 ] = '\0';
-      }
+      return m_nBytesReceived;
    }
-   else if ( pBuffer == nullptr )
+
+   // The segment size only accompanies buffers which were actually coalesced
+   nSegmentSize = static_cast<uint16_t>( m_nBytesReceived );
+   for ( cmsghdr* pHeader = CMSG_FIRSTHDR( &stMessage ); pHeader != nullptr;
+         pHeader = CMSG_NXTHDR( &stMessage, pHeader ) )
    {
-      m_sBuffer.erase( m_nBytesReceived );
+      if ( pHeader->cmsg_level == SOL_UDP && pHeader->cmsg_type == UDP_GRO )
+      {
+         int nSize = 0;
+         std::memcpy( &nSize, CMSG_DATA( pHeader ), sizeof( nSize ) );
+         nSegmentSize = static_cast<uint16_t>( nSize );
+      }
    }
 
    return m_nBytesReceived;
+#else
+   iovec stBuffer = { pBuffer, nMaxBytes };
+   const int32_t nReceived = Receive( &stBuffer, 1 );
+   nSegmentSize = ( nReceived > 0 ) ? static_cast<uint16_t>( nReceived ) : 0;
+   return nReceived;
+#endif
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -866,16 +2002,24 @@ bool CSimpleSocket::SetBlocking()
 //
 //-------------------------------------------------------------------------------------------------
 void CSimpleSocket::TranslateSocketError()
+{
+   SetSocketError( GetLastSystemError() );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// GetLastSystemError() -
+//
+//-------------------------------------------------------------------------------------------------
+CSimpleSocket::CSocketError CSimpleSocket::GetLastSystemError()
 {
 #if defined( _LINUX ) || defined( _DARWIN )
    switch ( errno )
    {
    case EXIT_SUCCESS:
-      SetSocketError( CSimpleSocket::SocketSuccess );
-      break;
+      return CSimpleSocket::SocketSuccess;
    case ENOTCONN:
-      SetSocketError( CSimpleSocket::SocketNotconnected );
-      break;
+      return CSimpleSocket::SocketNotconnected;
    case ENOTSOCK:
    case EBADF:
    case EACCES:
@@ -886,56 +2030,40 @@ void CSimpleSocket::TranslateSocketError()
    case ENOMEM:
    case EPROTONOSUPPORT:
    case EPIPE:
-      SetSocketError( CSimpleSocket::SocketInvalidSocket );
-      break;
+      return CSimpleSocket::SocketInvalidSocket;
    case ECONNREFUSED:
-      SetSocketError( CSimpleSocket::SocketConnectionRefused );
-      break;
+      return CSimpleSocket::SocketConnectionRefused;
    case ETIMEDOUT:
-      SetSocketError( CSimpleSocket::SocketTimedout );
-      break;
+      return CSimpleSocket::SocketTimedout;
    case EINPROGRESS:
-      SetSocketError( CSimpleSocket::SocketEinprogress );
-      break;
+      return CSimpleSocket::SocketEinprogress;
    case EWOULDBLOCK:
       //        case EAGAIN:
-      SetSocketError( CSimpleSocket::SocketEwouldblock );
-      break;
+      return CSimpleSocket::SocketEwouldblock;
    case EINTR:
-      SetSocketError( CSimpleSocket::SocketInterrupted );
-      break;
+      return CSimpleSocket::SocketInterrupted;
    case ECONNABORTED:
-      SetSocketError( CSimpleSocket::SocketConnectionAborted );
-      break;
+      return CSimpleSocket::SocketConnectionAborted;
    case EINVAL:
    case EADDRNOTAVAIL:
-      SetSocketError( SocketInvalidOperation );
-      break;
+      return SocketInvalidOperation;
    case EPROTO:
-      SetSocketError( CSimpleSocket::SocketProtocolError );
-      break;
+      return CSimpleSocket::SocketProtocolError;
    case EPERM:
-      SetSocketError( CSimpleSocket::SocketFirewallError );
-      break;
+      return CSimpleSocket::SocketFirewallError;
    case EFAULT:
-      SetSocketError( CSimpleSocket::SocketInvalidSocketBuffer );
-      break;
+      return CSimpleSocket::SocketInvalidSocketBuffer;
    case ECONNRESET:
    case ENOPROTOOPT:
-      SetSocketError( CSimpleSocket::SocketConnectionReset );
-      break;
+      return CSimpleSocket::SocketConnectionReset;
    case EADDRINUSE:
-      SetSocketError( CSimpleSocket::SocketAddressInUse );
-      break;
+      return CSimpleSocket::SocketAddressInUse;
    case EISCONN:
-      SetSocketError( CSimpleSocket::SocketAlreadyConnected );
-      break;
+      return CSimpleSocket::SocketAlreadyConnected;
    case ENETUNREACH:
-      SetSocketError( CSimpleSocket::SocketRoutingError );
-      break;
+      return CSimpleSocket::SocketRoutingError;
    default:
-      SetSocketError( CSimpleSocket::SocketEunknown );
-      break;
+      return CSimpleSocket::SocketEunknown;
    }
 #endif
 #ifdef WIN32
@@ -943,67 +2071,49 @@ void CSimpleSocket::TranslateSocketError()
    switch ( nError )
    {
    case EXIT_SUCCESS:
-      SetSocketError( CSimpleSocket::SocketSuccess );
-      break;
+      return CSimpleSocket::SocketSuccess;
    case WSAEBADF:
    case WSAENOTCONN:
-      SetSocketError( CSimpleSocket::SocketNotconnected );
-      break;
+      return CSimpleSocket::SocketNotconnected;
    case WSAEINTR:
-      SetSocketError( CSimpleSocket::SocketInterrupted );
-      break;
+      return CSimpleSocket::SocketInterrupted;
    case WSAEINVAL:
    case WSAENETUNREACH:
-      SetSocketError( SocketInvalidOperation );
-      break;
+      return SocketInvalidOperation;
    case WSAEACCES:
    case WSAEAFNOSUPPORT:
    case WSAEMFILE:
    case WSAENOBUFS:
-      SetSocketError( CSimpleSocket::SocketInvalidSocket );
-      break;
+      return CSimpleSocket::SocketInvalidSocket;
    case WSAEPROTONOSUPPORT:
    case WSAENOPROTOOPT:
-      SetSocketError( CSimpleSocket::SocketProtocolError );
-      break;
+      return CSimpleSocket::SocketProtocolError;
    case WSAECONNREFUSED:
-      SetSocketError( CSimpleSocket::SocketConnectionRefused );
-      break;
+      return CSimpleSocket::SocketConnectionRefused;
    case WSAETIMEDOUT:
-      SetSocketError( CSimpleSocket::SocketTimedout );
-      break;
+      return CSimpleSocket::SocketTimedout;
    case WSAEINPROGRESS:
-      SetSocketError( CSimpleSocket::SocketEinprogress );
-      break;
+      return CSimpleSocket::SocketEinprogress;
    case WSAECONNABORTED:
-      SetSocketError( CSimpleSocket::SocketConnectionAborted );
-      break;
+      return CSimpleSocket::SocketConnectionAborted;
    case WSAEWOULDBLOCK:
-      SetSocketError( CSimpleSocket::SocketEwouldblock );
-      break;
+      return CSimpleSocket::SocketEwouldblock;
    case WSAENOTSOCK:
-      SetSocketError( CSimpleSocket::SocketInvalidSocket );
-      break;
+      return CSimpleSocket::SocketInvalidSocket;
    case WSAECONNRESET:
-      SetSocketError( CSimpleSocket::SocketConnectionReset );
-      break;
+      return CSimpleSocket::SocketConnectionReset;
    case WSANO_DATA:
    case WSAEADDRNOTAVAIL:
    case WSAHOST_NOT_FOUND:
-      SetSocketError( CSimpleSocket::SocketInvalidAddress );
-      break;
+      return CSimpleSocket::SocketInvalidAddress;
    case WSAEADDRINUSE:
-      SetSocketError( CSimpleSocket::SocketAddressInUse );
-      break;
+      return CSimpleSocket::SocketAddressInUse;
    case WSAEFAULT:
-      SetSocketError( CSimpleSocket::SocketInvalidPointer );
-      break;
+      return CSimpleSocket::SocketInvalidPointer;
    case WSAEISCONN:
-      SetSocketError( CSimpleSocket::SocketAlreadyConnected );
-      break;
+      return CSimpleSocket::SocketAlreadyConnected;
    default:
-      SetSocketError( CSimpleSocket::SocketEunknown );
-      break;
+      return CSimpleSocket::SocketEunknown;
    }
 #endif
 }
@@ -1065,27 +2175,24 @@ std::string CSimpleSocket::DescribeError( CSocketError err )
 // Select()
 //
 //-------------------------------------------------------------------------------------------------
-bool CSimpleSocket::Select( int32_t nTimeoutSec, int32_t nTimeoutUSec )
+bool CSimpleSocket::Select( uint32_t nInterest, int32_t nTimeoutSec, int32_t nTimeoutUSec )
 {
    bool bRetVal = false;
-   timeval* pTimeout = nullptr;
-   auto timeout = timeval{ nTimeoutSec, nTimeoutUSec };
-
-   FD_ZERO( &m_errorFds );
-   FD_ZERO( &m_readFds );
-   FD_ZERO( &m_writeFds );
-   FD_SET( m_socket, &m_errorFds );
-   FD_SET( m_socket, &m_readFds );
-   FD_SET( m_socket, &m_writeFds );
-
-   // If a valid timeout has been specified then set value, otherwise set timeout to NULL which
-   // will block until a descriptor is ready for read/write or an error has occurred.
+   int32_t nTimeoutMs = -1;
+
+   // If a valid timeout has been specified then round it up to the next millisecond, otherwise
+   // block until the descriptor is ready or an error has occurred.
    if ( ( nTimeoutSec >= 0 ) || ( nTimeoutUSec >= 0 ) )
    {
-      pTimeout = &timeout;
+      nTimeoutMs = std::max( nTimeoutSec, 0 ) * 1000 + ( std::max( nTimeoutUSec, 0 ) + 999 ) / 1000;
    }
 
-   switch ( SELECT( m_socket + 1, &m_readFds, &m_writeFds, &m_errorFds, pTimeout ) )
+   // poll() is used rather than select() since an fd_set cannot hold descriptors past FD_SETSIZE
+   pollfd stPoll = { m_socket, ToPollEvents( nInterest ), 0 };
+
+   m_nReadiness = ReadinessNone;
+
+   switch ( POLL( &stPoll, 1, nTimeoutMs ) )
    {
    case SocketError:
       TranslateSocketError();
@@ -1094,8 +2201,10 @@ bool CSimpleSocket::Select( int32_t nTimeoutSec, int32_t nTimeoutUSec )
       SetSocketError( CSimpleSocket::SocketTimedout );
       break;
    default:
-      // If a file descriptor (read/write) is set then check the socket error to see if there is a pending error.
-      if ( FD_ISSET( m_socket, &m_readFds ) || FD_ISSET( m_socket, &m_writeFds ) )
+      m_nReadiness = FromPollEvents( stPoll.revents );
+
+      // If the descriptor is readable or writable then check the socket error to see if there is a pending error.
+      if ( m_nReadiness & ( ReadinessReadable | ReadinessWritable | ReadinessErrored ) )
       {
          int32_t nError = 0;
          int32_t nLen = sizeof( nError );
@@ -1103,7 +2212,7 @@ bool CSimpleSocket::Select( int32_t nTimeoutSec, int32_t nTimeoutUSec )
          if ( GETSOCKOPT( m_socket, SOL_SOCKET, SO_ERROR, &nError, &nLen ) == SocketSuccess )
          {
             errno = nError;
-            bRetVal = ( nError == 0 );
+            bRetVal = ( nError == 0 ) && ( m_nReadiness & nInterest ) != 0;
          }
 
          TranslateSocketError();
@@ -1114,8 +2223,65 @@ bool CSimpleSocket::Select( int32_t nTimeoutSec, int32_t nTimeoutUSec )
    return bRetVal;
 }
 
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::Select( int32_t nTimeoutSec, int32_t nTimeoutUSec )
+{
+   return Select( ReadinessReadable | ReadinessWritable, nTimeoutSec, nTimeoutUSec );
+}
+
 //-------------------------------------------------------------------------------------------------
 bool CSimpleSocket::Select()
 {
    return Select( -1, -1 );   // Specify Blocking Select
 }
+
+//-------------------------------------------------------------------------------------------------
+void CSimpleSocket::RestoreBlocking( bool bSwitched )
+{
+   if ( bSwitched )
+   {
+      // Keep the outcome of the transfer rather than that of the switch
+      const CSocketError error = GetSocketError();
+      SetBlocking();
+      SetSocketError( error );
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CSimpleSocket::WaitForTransfer( uint32_t nInterest, int32_t nTimeoutMs, std::chrono::steady_clock::time_point start )
+{
+   if ( nTimeoutMs < 0 )
+   {
+      return Select( nInterest, -1, -1 );
+   }
+
+   const auto nElapsedMs =
+       std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start ).count();
+   if ( nElapsedMs >= nTimeoutMs )
+   {
+      SetSocketError( SocketTimedout );
+      return false;
+   }
+
+   const auto nRemainingMs = static_cast<int32_t>( nTimeoutMs - nElapsedMs );
+   return Select( nInterest, nRemainingMs / 1000, ( nRemainingMs % 1000 ) * 1000 );
+}
+
+//-------------------------------------------------------------------------------------------------
+short CSimpleSocket::ToPollEvents( uint32_t nInterest )
+{
+   short nEvents = 0;
+   if ( nInterest & ReadinessReadable ) nEvents |= POLLIN;
+   if ( nInterest & ReadinessWritable ) nEvents |= POLLOUT;
+   return nEvents;
+}
+
+//-------------------------------------------------------------------------------------------------
+uint32_t CSimpleSocket::FromPollEvents( short nEvents )
+{
+   uint32_t nReadiness = ReadinessNone;
+   if ( nEvents & ( POLLIN | POLLHUP ) ) nReadiness |= ReadinessReadable;
+   if ( nEvents & POLLOUT ) nReadiness |= ReadinessWritable;
+   if ( nEvents & ( POLLERR | POLLHUP | POLLNVAL ) ) nReadiness |= ReadinessErrored;
+   return nReadiness;
+}
@@ -9,6 +9,7 @@
 #include <cerrno>
 #include <cstring>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #endif
@@ -21,11 +22,14 @@
 #include <winsock2.h>
 #endif
 
+#include "DataView.h"
 #include "Host.h"
 #include "StatTimer.h"
 
 #include <string>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #ifdef STRING_VIEW
 #include <string_view>
@@ -87,8 +91,54 @@ public:
       SocketEunknown               ///< Unknown error please report to mark@carrierlabs.com
    };
 
+   /// Conditions Select() can wait for, combined as a mask.
+   enum CReadiness : uint32_t
+   {
+      ReadinessNone = 0,
+      ReadinessReadable = 1 << 0,   ///< Data, a connection or an orderly shutdown is pending.
+      ReadinessWritable = 1 << 1,   ///< Space is available in the send buffer or a connect completed.
+      ReadinessErrored = 1 << 2     ///< An error or hang up is pending, always reported.
+   };
+
+   /// Options for a single Send(), combined as a mask.
+   enum CSendFlag : uint32_t
+   {
+      SendDefault = 0,
+      SendMore = 1 << 0   ///< More data follows, hold back a partial segment (MSG_MORE). Linux only.
+   };
+
+   /// One datagram of SendBatch() or ReceiveBatch().
+   struct CDatagram
+   {
+      iovec stBuffer = {};       ///< Data to send, or space to receive into.
+      sockaddr_in stAddr = {};   ///< Destination, AF_UNSPEC sends where Send() would. Source once received.
+      uint32_t nLength = 0;      ///< Bytes sent or received.
+   };
+
+   /// Outcome of TrySend() or TryReceive(), the number of bytes moved or why nothing was.
+   struct CTransfer
+   {
+      int32_t nBytes;       ///< Bytes sent or received, CSimpleSocket::SocketError on failure.
+      CSocketError error;   ///< CSimpleSocket::SocketSuccess unless it failed.
+
+      explicit operator bool() const { return error == SocketSuccess; }
+   };
+
+   /// Range of SendZeroCopy() calls whose buffers the kernel has released.
+   struct CZeroCopyCompletion
+   {
+      uint32_t nFirst;   ///< Identifier of the first send released.
+      uint32_t nLast;    ///< Identifier of the last send released, inclusive.
+      bool bCopied;      ///< The kernel fell back to copying, zero copy did not pay off for these.
+   };
+
 public:
    explicit CSimpleSocket( CSocketType type = SocketTypeTcp );
+
+   /// Take ownership of a handle created elsewhere, for instance by accept(), instead of
+   /// creating one. With INVALID_SOCKET the handle is only created by the first Open() or Listen().
+   CSimpleSocket( SOCKET socket, CSocketType type );
+
    CSimpleSocket( const CSimpleSocket& ) = delete;
    CSimpleSocket( CSimpleSocket&& socket ) noexcept;
    virtual ~CSimpleSocket();
@@ -97,20 +147,50 @@ public:
    CSimpleSocket& operator=( CSimpleSocket&& other ) noexcept;
 
    friend void swap( CSimpleSocket& lhs, CSimpleSocket& rhs ) noexcept;
+   friend class CEventLoop;
+   friend class CIoUring;
+   friend class CSocketSet;
+   friend class CRelay;
+   friend class CZeroCopyReceiver;
+   friend class CSocketRecycler;
+   template <class Protocol, class TimingPolicy, class ErrorPolicy> friend class CBasicSocket;
 
    bool Shutdown( CShutdownMode nShutdown );
    bool Close();
 
    bool Select();
    bool Select( int32_t nTimeoutSec, int32_t nTimeoutUSec );
+   bool Select( uint32_t nInterest, int32_t nTimeoutSec, int32_t nTimeoutUSec );
+
+   /// @return mask of CReadiness reported by the last Select().
+   [[nodiscard]] uint32_t GetReadiness() const { return m_nReadiness; }
 
    [[nodiscard]] bool IsSocketValid() const { return ( m_socket != INVALID_SOCKET ); }
 
    static std::string DescribeError( CSocketError err );
+
+   /// Map the last operating system error of this thread to a CSocketError, without touching any socket.
+   [[nodiscard]] static CSocketError GetLastSystemError();
    [[nodiscard]] std::string DescribeError() const { return DescribeError( m_error ); }
 
    int32_t Receive( uint32_t nMaxBytes = 1, uint8_t* pBuffer = nullptr );
 
+   /// Attempts to receive into several buffers with one call, filling each before the next.
+   /// The internal buffer returned by GetData() is left untouched.
+   /// @param pVectors buffers to be filled.
+   /// @param nCount number of buffers.
+   /// @return number of bytes received across all buffers, zero if the remote closed the
+   /// connection or -1 if an error occurred.
+   int32_t Receive( iovec* pVectors, size_t nCount );
+
+   /// Receive a buffer of one or more datagrams, coalesced when SetReceiveCoalescing() is enabled.
+   /// @param pBuffer memory where to receive the data, 64KiB holds any coalesced buffer.
+   /// @param nMaxBytes size of pBuffer.
+   /// @param nSegmentSize set to the size of each datagram in the buffer, the last one may be
+   /// shorter. Equals the return value when nothing was coalesced.
+   /// @return number of bytes received, or -1 if an error occurred.
+   int32_t ReceiveCoalesced( uint8_t* pBuffer, uint32_t nMaxBytes, uint16_t& nSegmentSize );
+
    /// Attempts to send a block of data on an established connection.
    /// @param pBuf block of data to be sent.
    /// @param bytesToSend size of data block to be sent.
@@ -119,6 +199,89 @@ public:
    /// @return of -1 means that an error has occurred.
    virtual int32_t Send( const uint8_t* pBuf, size_t bytesToSend );
 
+   /// Send with options, for instance CSendFlag::SendMore for every part of a response but the
+   /// last so it is coalesced into as few segments as possible.
+   /// @param nSendFlags mask of CSendFlag.
+   int32_t Send( const uint8_t* pBuf, size_t bytesToSend, uint32_t nSendFlags );
+
+   /// Attempts to send several blocks of data as one, for instance a header and its payload,
+   /// without first copying them together.
+   /// @param pVectors blocks of data to be sent, in order.
+   /// @param nCount number of blocks.
+   /// @return number of bytes actually sent, or -1 if an error occurred.
+   int32_t Send( const iovec* pVectors, size_t nCount );
+
+   /// Send the whole block of data, retrying partial writes. A non-blocking socket, or any socket
+   /// given a deadline, waits for room in the send buffer between attempts.
+   /// Only valid on CSocketType::SocketTypeTcp sockets.
+   /// <br/><br/>\b NOTE: Where MSG_DONTWAIT is missing, such as Windows, a blocking socket given a
+   /// deadline is made non-blocking for the duration of the call. The same goes for ReceiveExactly().
+   /// @param nTimeoutMs overall deadline in milliseconds, -1 waits as long as it takes.
+   /// @return number of bytes sent, which is short of bytesToSend when the deadline passed
+   /// (CSimpleSocket::SocketTimedout) or an error occurred, or -1 if nothing could be sent.
+   int32_t SendAll( const uint8_t* pBuf, size_t bytesToSend, int32_t nTimeoutMs = -1 );
+
+   /// Receive exactly nBytes, retrying partial reads. A blocking socket without a deadline has
+   /// the kernel gather the whole block, otherwise it waits for data between attempts.
+   /// Only valid on CSocketType::SocketTypeTcp sockets.
+   /// @param pBuffer memory where to receive the data, NULL receives to internal buffer returned with GetData().
+   /// @param nTimeoutMs overall deadline in milliseconds, -1 waits as long as it takes.
+   /// @return number of bytes received, which is short of nBytes when the remote closed the
+   /// connection (no error is set), the deadline passed (CSimpleSocket::SocketTimedout) or an
+   /// error occurred, or -1 if nothing could be received.
+   int32_t ReceiveExactly( uint8_t* pBuffer, uint32_t nBytes, int32_t nTimeoutMs = -1 );
+
+   /// Send like Send() but report the outcome only in the result, leaving the error, byte
+   /// counts and timer of the socket alone. One thread may send this way while another receives
+   /// with TryReceive(), and a successful send skips the error translation.
+   [[nodiscard]] CTransfer TrySend( const uint8_t* pBuf, size_t bytesToSend, uint32_t nSendFlags = SendDefault );
+
+   /// Receive into pBuffer like Receive() but report the outcome only in the result, see TrySend().
+   /// @param pSource where to store the sender of a datagram, not kept by the socket.
+   [[nodiscard]] CTransfer TryReceive( uint8_t* pBuffer, uint32_t nMaxBytes, sockaddr_in* pSource = nullptr );
+
+   /// Send several datagrams with as few system calls as possible, sendmmsg() on Linux.
+   /// Only valid on CSocketType::SocketTypeUdp sockets. GetBytesSent() is the total of the batch.
+   /// @return number of datagrams sent, which stops short at the first failure, or -1 on error.
+   int32_t SendBatch( CDatagram* pDatagrams, size_t nCount );
+
+   /// Receive up to nCount datagrams, waiting only for the first one, recvmmsg() on Linux.
+   /// Only valid on CSocketType::SocketTypeUdp sockets. GetBytesReceived() is the total of the batch.
+   /// @return number of datagrams received, or -1 on error.
+   int32_t ReceiveBatch( CDatagram* pDatagrams, size_t nCount );
+
+   /// Send one large buffer as consecutive datagrams of nSegmentSize bytes, the last may be shorter.
+   /// Uses UDP generic segmentation offload so the kernel splits the buffer, or SendBatch() where
+   /// UDP_SEGMENT is not supported. Only valid on CSocketType::SocketTypeUdp sockets.
+   /// @return number of bytes sent, which stops short at the first failure, or -1 on error.
+   int32_t SendSegmented( const uint8_t* pBuf, size_t bytesToSend, uint16_t nSegmentSize );
+
+   /// Send part of a file straight from the page cache, the data never crosses into userspace.
+   /// A partial transfer is retried until nCount bytes are sent, except on a non-blocking socket
+   /// which returns the progress so far with CSimpleSocket::SocketEwouldblock set.
+   /// @param nFile open file descriptor to read from, its file offset is not changed.
+   /// @param nOffset position in the file to start from.
+   /// @param nCount number of bytes to send.
+   /// @return number of bytes sent, which is short of nCount at the end of the file or on
+   /// error, or -1 if nothing could be sent.
+   int64_t SendFile( int nFile, off_t nOffset, size_t nCount );
+
+   /// Allow SendZeroCopy() on this socket (SO_ZEROCOPY). Only supported on Linux.
+   /// @return false if the option is not supported or could not be set.
+   bool SetZeroCopy( bool bEnable );
+
+   /// Send a block of data by pinning the caller's pages rather than copying them (MSG_ZEROCOPY).
+   /// The buffer must not be modified or freed until ReapZeroCopyCompletions() reports nId.
+   /// @param nId set to the identifier of this send, consecutive from zero for each socket.
+   /// @return number of bytes actually sent, or -1 if an error occurred and no identifier was used.
+   int32_t SendZeroCopy( const uint8_t* pBuf, size_t bytesToSend, uint32_t& nId );
+
+   /// Collect the buffer release notifications queued by the kernel, never blocks. The socket
+   /// is reported as CReadiness::ReadinessErrored by Select() while notifications are pending.
+   /// @param completions receives the released ranges, it is not cleared.
+   /// @return number of ranges appended, or -1 on error.
+   int32_t ReapZeroCopyCompletions( std::vector<CZeroCopyCompletion>& completions );
+
 #ifdef STRING_VIEW
    int32_t Send( std::string_view bytes )
    {
@@ -130,7 +293,8 @@ public:
    bool SetBlocking();
    bool SetNonblocking();
 
-   [[nodiscard]] const std::string& GetData() const { return m_sBuffer; }
+   /// View of the bytes from the last Receive() into the internal buffer, valid until the next one.
+   [[nodiscard]] CDataView GetData() const { return { m_pBuffer.get(), m_nBufferLength }; }
    [[nodiscard]] int32_t GetBytesReceived() const { return m_nBytesReceived; }
    [[nodiscard]] int32_t GetBytesSent() const { return m_nBytesSent; }
 
@@ -168,21 +332,26 @@ public:
    /// @return true if option successfully set
    bool SetOptionReuseAddr();
 
-   [[nodiscard]] int32_t GetConnectTimeoutSec() const { return m_stConnectTimeout.tv_sec; }
-   [[nodiscard]] int32_t GetConnectTimeoutUSec() const { return m_stConnectTimeout.tv_usec; }
+   [[nodiscard]] int32_t GetConnectTimeoutSec() const { return GetSettings().stConnectTimeout.tv_sec; }
+   [[nodiscard]] int32_t GetConnectTimeoutUSec() const { return GetSettings().stConnectTimeout.tv_usec; }
    void SetConnectTimeout( int32_t nConnectTimeoutSec, int32_t nConnectTimeoutUsec );
 
-   [[nodiscard]] int32_t GetReceiveTimeoutSec() const { return m_stRecvTimeout.tv_sec; }
-   [[nodiscard]] int32_t GetReceiveTimeoutUSec() const { return m_stRecvTimeout.tv_usec; }
+   [[nodiscard]] int32_t GetReceiveTimeoutSec() const { return GetSettings().stRecvTimeout.tv_sec; }
+   [[nodiscard]] int32_t GetReceiveTimeoutUSec() const { return GetSettings().stRecvTimeout.tv_usec; }
    bool SetReceiveTimeout( int32_t nRecvTimeoutSec, int32_t nRecvTimeoutUsec = 0 );
 
-   [[nodiscard]] int32_t GetSendTimeoutSec() const { return m_stSendTimeout.tv_sec; }
-   [[nodiscard]] int32_t GetSendTimeoutUSec() const { return m_stSendTimeout.tv_usec; }
+   [[nodiscard]] int32_t GetSendTimeoutSec() const { return GetSettings().stSendTimeout.tv_sec; }
+   [[nodiscard]] int32_t GetSendTimeoutUSec() const { return GetSettings().stSendTimeout.tv_usec; }
    bool SetSendTimeout( int32_t nSendTimeoutSec, int32_t nSendTimeoutUsec = 0 );
 
    bool SetMulticast( bool bEnable, uint8_t multicastTTL = 1 );
    [[nodiscard]] bool GetMulticast() const { return m_bIsMulticast; }
 
+   /// Let the kernel coalesce consecutive datagrams from the same flow (UDP_GRO) so a single
+   /// ReceiveCoalesced() returns many of them. Only valid on CSocketType::SocketTypeUdp sockets.
+   /// @return false if the option is not supported or could not be set.
+   bool SetReceiveCoalescing( bool bEnable );
+
    /// Get the total time the of the last operation in milliseconds.
    ///  @return number of milliseconds of last operation.
    [[nodiscard]] auto GetTotalTimeMs() const { return m_timer.GetMilliSeconds(); }
@@ -241,7 +410,20 @@ public:
    /// @return false if failed to set socket option otherwise return true;
    bool EnableNagleAlgoritm();
 
-   /// Flush the socket descriptor owned by the object.
+   /// Hold back partial segments until Uncork() so several Send() calls go out in as few
+   /// segments as possible (TCP_CORK, or TCP_NOPUSH on BSD derived systems).
+   /// The kernel releases corked data on its own after 200ms.
+   /// @return false if failed to set socket option otherwise return true;
+   bool Cork();
+
+   /// Transmit any data held back by Cork() and send immediately again.
+   /// @return false if failed to set socket option otherwise return true;
+   bool Uncork();
+
+   [[nodiscard]] bool IsCorked() const { return m_bIsCorked; }
+
+   /// Push out data waiting in the send buffer for Nagle's algorithm or a cork, without
+   /// changing either setting.
    /// @return true data was successfully sent, else return false;
    bool Flush();
    
@@ -250,6 +432,11 @@ protected:
    /// @return true if properly initialized.
    bool ObtainNewHandle();
 
+   /// Create the handle of a socket constructed without one, see CSimpleSocket( SOCKET, CSocketType ).
+   /// A socket which was closed stays closed.
+   /// @return true if the socket has a handle.
+   bool EnsureHandle();
+
    /// Set internal socket error to that specified error
    ///  @param error type of error
    void SetSocketError( CSimpleSocket::CSocketError error ) { m_error = error; }
@@ -258,14 +445,33 @@ protected:
    /// operating system error to an error defined by the CSimpleSocket class.
    void TranslateSocketError();
 
+   /// Close the socket and start over as if constructed by CSimpleSocket( SOCKET, CSocketType ),
+   /// keeping only the receive buffer allocation.
+   void Reset( SOCKET socket, CSocketType type );
+
    /// Set object socket handle to that specified as parameter
    ///  @param socket value of socket descriptor
    void SetSocketHandle( SOCKET socket ) { m_socket = socket; }
 
+   /// Convert between a mask of CReadiness and the poll() event flags.
+   static short ToPollEvents( uint32_t nInterest );
+   static uint32_t FromPollEvents( short nEvents );
+
    virtual sockaddr_in* GetUdpRxAddrBuffer() { return &m_stClientSockaddr; }
-   virtual sockaddr_in* GetUdpTxAddrBuffer() { return m_bIsMulticast ? &m_stMulticastGroup : &m_stClientSockaddr; }
+   virtual sockaddr_in* GetUdpTxAddrBuffer() { return m_bIsMulticast ? &GetMutableSettings().stMulticastGroup : &m_stClientSockaddr; }
+
+   /// Destination of TrySend(), which may run alongside a receive on another thread. Unlike
+   /// GetUdpTxAddrBuffer() it never allocates the settings to read the multicast group.
+   [[nodiscard]] const sockaddr_in* GetUdpTxAddr() const
+   {
+      // For unicast the overrides only pick one of their addresses
+      return m_bIsMulticast ? &GetSettings().stMulticastGroup : const_cast<CSimpleSocket*>( this )->GetUdpTxAddrBuffer();
+   }
 
    static constexpr int SOCKET_ADDR_IN_SIZE = sizeof( sockaddr_in );
+   static constexpr size_t BATCH_CHUNK_SIZE = 64;   /// datagrams per sendmmsg()/recvmmsg()
+   static constexpr size_t MAX_GSO_SEGMENTS = 64;   /// UDP_MAX_SEGMENTS of older kernels
+   static constexpr size_t MAX_UDP_PAYLOAD = 65507; /// largest buffer a single GSO send may carry
 
 private:
    /// Generic function used to get the send/receive window size
@@ -279,33 +485,61 @@ private:
    bool BindUnicastInterface( const char* pInterface );
    bool BindMulticastInterface( const char* pInterface );
 
+   /// Set or clear TCP_CORK, shared by Cork(), Uncork() and Flush().
+   bool SetCorked( bool bCorked );
+
+   /// Split a buffer into datagrams in userspace, for when the kernel cannot segment it.
+   int32_t SendSegmentedBatch( const uint8_t* pBuf, size_t bytesToSend, uint16_t nSegmentSize );
+
+   /// Make room for nMaxBytes in the internal buffer, which only ever grows, and empty it.
+   uint8_t* PrepareBuffer( uint32_t nMaxBytes );
+
+   /// Wait for nInterest with what is left of nTimeoutMs since start, -1 waits as long as it takes.
+   bool WaitForTransfer( uint32_t nInterest, int32_t nTimeoutMs, std::chrono::steady_clock::time_point start );
+
+   /// Make the socket blocking again if bSwitched, after a transfer which had to switch it, see SendAll().
+   void RestoreBlocking( bool bSwitched );
+
 protected:
+   /// Settings few sockets change, kept out of line so an idle connection stays small.
+   struct CSettings
+   {
+      timeval stConnectTimeout = { 0, 0 };   /// connection timeout
+      timeval stRecvTimeout = { 0, 0 };      /// receive timeout
+      timeval stSendTimeout = { 0, 0 };      /// send timeout
+      sockaddr_in stMulticastGroup = {};     /// multi-cast group to bind to
+   };
+
+   /// @return settings in use, the defaults until one is changed.
+   [[nodiscard]] const CSettings& GetSettings() const { return m_pSettings ? *m_pSettings : DEFAULT_SETTINGS; }
+
+   /// @return settings to change, allocated on first use.
+   CSettings& GetMutableSettings();
+
+   static const CSettings DEFAULT_SETTINGS;
+
+   // Ordered by alignment so none of the members need padding
    SOCKET m_socket = INVALID_SOCKET;                /// socket handle
    CSocketError m_error = SocketInvalidSocket;      /// number of last error
-   std::string m_sBuffer;                           /// internal send/receive buffer
+   std::unique_ptr<char[]> m_pBuffer;               /// internal receive buffer, reused across calls
+   std::unique_ptr<CSettings> m_pSettings;          /// null while every setting has its default
+   CStatTimer m_timer;                              /// internal statistics.
+   uint32_t m_nBufferCapacity = 0;                  /// bytes allocated for m_pBuffer, excluding the terminator
+   uint32_t m_nBufferLength = 0;                    /// bytes held in m_pBuffer
    int32_t m_nSocketDomain = AF_UNSPEC;             /// socket domain IPv4 (AF_INET) or IPv6 (AF_INET6)
    CSocketType m_nSocketType = SocketTypeInvalid;   /// socket type - UDP, TCP or RAW
    int32_t m_nBytesReceived = -1;                   /// number of bytes received
    int32_t m_nBytesSent = -1;                       /// number of bytes sent
    uint32_t m_nFlags = 0;                           /// socket flags
-   bool m_bIsBlocking = true;                       /// is socket blocking
-   bool m_bIsMulticast = false;                     /// is the UDP socket multi-cast;
-   timeval m_stConnectTimeout = { 0, 0 };           /// connection timeout
-   timeval m_stRecvTimeout = { 0, 0 };              /// receive timeout
-   timeval m_stSendTimeout = { 0, 0 };              /// send timeout
+   uint32_t m_nReadiness = ReadinessNone;           /// conditions reported by the last select
+   uint32_t m_nZeroCopyNext = 0;                    /// identifier of the next zero copy send
    sockaddr_in m_stServerSockaddr = {};             /// server address
    sockaddr_in m_stClientSockaddr = {};             /// client address
-   sockaddr_in m_stMulticastGroup = {};             /// multi-cast group to bind to
-   linger m_stLinger = { 0, 0 };                    /// linger flag
-   CStatTimer m_timer;                              /// internal statistics.
-
-#ifdef WIN32
-   WSADATA m_hWSAData = {};   /// Windows
-#endif
-
-   fd_set m_writeFds = { 0, 0 };   /// write file descriptor set
-   fd_set m_readFds = { 0, 0 };    /// read file descriptor set
-   fd_set m_errorFds = { 0, 0 };   /// error file descriptor set
+   bool m_bIsBlocking = true;                       /// is socket blocking
+   bool m_bIsMulticast = false;                     /// is the UDP socket multi-cast;
+   bool m_bIsCorked = false;                        /// are partial segments held back
+   bool m_bDeferredHandle = false;                  /// handle is created on first use
+   bool m_bZeroCopy = false;                        /// SO_ZEROCOPY is enabled
 };
 
 #endif   //  __SOCKET_H__
@@ -0,0 +1,90 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "SocketRecycler.h"
+
+#include <typeinfo>
+
+//-------------------------------------------------------------------------------------------------
+CSocketRecycler::CSocketRecycler( size_t nCapacity ) : m_nCapacity( nCapacity )
+{
+   m_sockets.reserve( m_nCapacity );   // Recycling never allocates
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Acquire()
+//
+//-------------------------------------------------------------------------------------------------
+std::unique_ptr<CActiveSocket> CSocketRecycler::Acquire( SOCKET socket, CSimpleSocket::CSocketType type )
+{
+   std::unique_ptr<CActiveSocket> pSocket;
+
+   {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      if ( !m_sockets.empty() )
+      {
+         pSocket = std::move( m_sockets.back() );
+         m_sockets.pop_back();
+      }
+   }
+
+   if ( pSocket == nullptr )
+   {
+      return std::make_unique<CActiveSocket>( socket, type );
+   }
+
+   pSocket->Reset( socket, type );
+   return pSocket;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Recycle()
+//
+//-------------------------------------------------------------------------------------------------
+void CSocketRecycler::Recycle( std::unique_ptr<CActiveSocket> pSocket )
+{
+   if ( pSocket == nullptr || typeid( *pSocket ) != typeid( CActiveSocket ) )
+   {
+      return;
+   }
+
+   pSocket->Close();   // Not while holding the lock, closing can linger
+
+   std::lock_guard<std::mutex> lock( m_mutex );
+   if ( m_sockets.size() < m_nCapacity )
+   {
+      m_sockets.push_back( std::move( pSocket ) );
+   }
+}
+
+//-------------------------------------------------------------------------------------------------
+size_t CSocketRecycler::GetSize() const
+{
+   std::lock_guard<std::mutex> lock( m_mutex );
+   return m_sockets.size();
+}
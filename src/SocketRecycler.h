@@ -0,0 +1,63 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __SOCKETRECYCLER_H__
+#define __SOCKETRECYCLER_H__
+
+#include "ActiveSocket.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Keeps closed CActiveSocket objects, along with their receive buffers, so accepting connections
+/// under churn does not go back to the allocator. Pass it to CPassiveSocket::Accept() and hand
+/// the sockets back with Recycle() instead of destroying them. Safe to use from several threads.
+class CSocketRecycler
+{
+public:
+   explicit CSocketRecycler( size_t nCapacity = DEFAULT_CAPACITY );
+
+   /// A socket owning the handle, reset to the state of a new one but reusing a recycled object
+   /// when there is one.
+   std::unique_ptr<CActiveSocket> Acquire( SOCKET socket, CSimpleSocket::CSocketType type = CSimpleSocket::SocketTypeTcp );
+
+   /// Close the socket and keep it for reuse, it is destroyed if the recycler is full or it is
+   /// of a class derived from CActiveSocket.
+   void Recycle( std::unique_ptr<CActiveSocket> pSocket );
+
+   /// @return number of sockets waiting to be reused.
+   [[nodiscard]] size_t GetSize() const;
+
+   static constexpr size_t DEFAULT_CAPACITY = 1024;   /// sockets kept for reuse
+
+private:
+   mutable std::mutex m_mutex;
+   std::vector<std::unique_ptr<CActiveSocket>> m_sockets;
+   size_t m_nCapacity;
+};
+
+#endif   // __SOCKETRECYCLER_H__
@@ -0,0 +1,185 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "SocketSet.h"
+
+#include <algorithm>
+#include <chrono>
+
+//-------------------------------------------------------------------------------------------------
+//
+// Add()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSocketSet::Add( CSimpleSocket& socket, uint32_t nInterest )
+{
+   if ( !socket.IsSocketValid() )
+   {
+      socket.SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      return false;
+   }
+
+   const auto itor = std::find( m_sockets.begin(), m_sockets.end(), &socket );
+   if ( itor != m_sockets.end() )
+   {
+      pollfd& stPoll = m_descriptors[ std::distance( m_sockets.begin(), itor ) ];
+      stPoll.fd = socket.m_socket;   // The socket may have been re-opened since
+      stPoll.events = CSimpleSocket::ToPollEvents( nInterest );
+      return true;
+   }
+
+   m_sockets.push_back( &socket );
+   m_descriptors.push_back( { socket.m_socket, CSimpleSocket::ToPollEvents( nInterest ), 0 } );
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Remove()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSocketSet::Remove( const CSimpleSocket& socket )
+{
+   const auto itor = std::find( m_sockets.begin(), m_sockets.end(), &socket );
+   if ( itor == m_sockets.end() )
+   {
+      return false;
+   }
+
+   m_descriptors.erase( m_descriptors.begin() + std::distance( m_sockets.begin(), itor ) );
+   m_sockets.erase( itor );
+   m_ready.clear();   // Might refer to the removed socket
+   return true;
+}
+
+//-------------------------------------------------------------------------------------------------
+void CSocketSet::Clear()
+{
+   m_sockets.clear();
+   m_descriptors.clear();
+   m_ready.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// WaitAny()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CSocketSet::WaitAny( int32_t nTimeoutMs )
+{
+   m_ready.clear();
+
+   const int32_t nReady = Poll( m_descriptors, nTimeoutMs );
+   if ( nReady <= 0 )
+   {
+      return nReady;
+   }
+
+   for ( size_t i = 0; i < m_descriptors.size(); ++i )
+   {
+      if ( m_descriptors[ i ].revents != 0 )
+      {
+         CSimpleSocket* pSocket = m_sockets[ i ];
+         pSocket->m_nReadiness = CSimpleSocket::FromPollEvents( m_descriptors[ i ].revents );
+         m_ready.push_back( { pSocket, pSocket->m_nReadiness } );
+      }
+   }
+
+   return static_cast<int32_t>( m_ready.size() );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// WaitAll()
+//
+//-------------------------------------------------------------------------------------------------
+bool CSocketSet::WaitAll( int32_t nTimeoutMs )
+{
+   using Clock = std::chrono::steady_clock;
+   const auto deadline = Clock::now() + std::chrono::milliseconds( nTimeoutMs );
+
+   std::vector<uint32_t> readiness( m_sockets.size(), CSimpleSocket::ReadinessNone );
+   std::vector<pollfd> pending = m_descriptors;
+   std::vector<size_t> indices( m_sockets.size() );
+   for ( size_t i = 0; i < indices.size(); ++i ) indices[ i ] = i;
+
+   // Only poll the sockets which are still outstanding so those already ready do not spin the loop
+   while ( !pending.empty() )
+   {
+      int32_t nRemainingMs = -1;
+      if ( nTimeoutMs >= 0 )
+      {
+         const auto remaining = std::chrono::ceil<std::chrono::milliseconds>( deadline - Clock::now() );
+         nRemainingMs = static_cast<int32_t>( std::max<int64_t>( remaining.count(), 0 ) );
+      }
+
+      if ( Poll( pending, nRemainingMs ) <= 0 )
+      {
+         break;
+      }
+
+      size_t nKept = 0;
+      for ( size_t i = 0; i < pending.size(); ++i )
+      {
+         if ( pending[ i ].revents != 0 )
+         {
+            readiness[ indices[ i ] ] = CSimpleSocket::FromPollEvents( pending[ i ].revents );
+            m_sockets[ indices[ i ] ]->m_nReadiness = readiness[ indices[ i ] ];
+            continue;
+         }
+
+         pending[ nKept ] = pending[ i ];
+         indices[ nKept ] = indices[ i ];
+         ++nKept;
+      }
+
+      pending.resize( nKept );
+      indices.resize( nKept );
+   }
+
+   m_ready.clear();
+   for ( size_t i = 0; i < m_sockets.size(); ++i )
+   {
+      if ( readiness[ i ] != CSimpleSocket::ReadinessNone )
+      {
+         m_ready.push_back( { m_sockets[ i ], readiness[ i ] } );
+      }
+   }
+
+   return pending.empty();
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CSocketSet::Poll( std::vector<pollfd>& descriptors, int32_t nTimeoutMs )
+{
+   int32_t nReady = 0;
+   do
+   {
+      nReady = POLL( descriptors.data(), descriptors.size(), nTimeoutMs );
+   } while ( nReady == CSimpleSocket::SocketError && errno == EINTR );
+
+   return nReady;
+}
@@ -0,0 +1,80 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __SOCKETSET_H__
+#define __SOCKETSET_H__
+
+#include "SimpleSocket.h"
+
+#include <vector>
+
+/// Collection of sockets which can be waited on together with a single poll() call, for
+/// synchronous clients talking to several peers without a thread each. Sockets are not
+/// owned, they must be removed before they are destroyed.
+class CSocketSet
+{
+public:
+   /// A socket which satisfied the wait and the mask of CSimpleSocket::CReadiness it reported.
+   struct CReady
+   {
+      CSimpleSocket* pSocket;
+      uint32_t nReadiness;
+   };
+
+   /// Add a socket, or update the conditions it is watched for if already present.
+   /// @param nInterest mask of CSimpleSocket::ReadinessReadable and ReadinessWritable.
+   /// @return false if the socket is not valid, the reason is set on the socket.
+   bool Add( CSimpleSocket& socket, uint32_t nInterest = CSimpleSocket::ReadinessReadable );
+
+   /// @return false if the socket was not in the set.
+   bool Remove( const CSimpleSocket& socket );
+
+   void Clear();
+
+   [[nodiscard]] size_t GetSize() const { return m_sockets.size(); }
+
+   /// Wait until at least one socket is ready.
+   /// @param nTimeoutMs milliseconds to wait, -1 blocks until a socket is ready.
+   /// @return number of ready sockets, 0 on timeout or -1 if the wait failed.
+   int32_t WaitAny( int32_t nTimeoutMs = -1 );
+
+   /// Wait until every socket has been ready at least once, or reported an error.
+   /// @param nTimeoutMs milliseconds to wait in total, -1 blocks until all are ready.
+   /// @return true if all sockets became ready, otherwise GetReady() holds those that did.
+   bool WaitAll( int32_t nTimeoutMs = -1 );
+
+   /// @return sockets which satisfied the last wait, in the order they were added.
+   [[nodiscard]] const std::vector<CReady>& GetReady() const { return m_ready; }
+
+private:
+   int32_t Poll( std::vector<pollfd>& descriptors, int32_t nTimeoutMs );
+
+   std::vector<CSimpleSocket*> m_sockets;   /// members of the set
+   std::vector<pollfd> m_descriptors;       /// kernel input, parallel to m_sockets
+   std::vector<CReady> m_ready;             /// output of the last wait
+};
+
+#endif   // __SOCKETSET_H__
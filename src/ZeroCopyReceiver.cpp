@@ -0,0 +1,159 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "ZeroCopyReceiver.h"
+
+#ifdef _LINUX
+
+#include <sys/mman.h>
+
+#include <algorithm>
+
+CZeroCopyReceiver::CZeroCopyReceiver( CSimpleSocket& socket, size_t nWindowSize ) : m_socket( socket )
+{
+   const size_t nPageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+   m_nWindowSize = ( std::max<size_t>( nWindowSize, 1 ) + nPageSize - 1 ) / nPageSize * nPageSize;
+   m_copy.resize( m_nWindowSize );
+
+   // The window is a mapping of the socket itself, sockets without support simply refuse it
+   void* pWindow = mmap( nullptr, m_nWindowSize, PROT_READ, MAP_SHARED, m_socket.m_socket, 0 );
+   if ( pWindow != MAP_FAILED )
+   {
+      m_pWindow = static_cast<uint8_t*>( pWindow );
+   }
+}
+
+CZeroCopyReceiver::~CZeroCopyReceiver()
+{
+   if ( m_pWindow != nullptr ) munmap( m_pWindow, m_nWindowSize );
+}
+
+//-------------------------------------------------------------------------------------------------
+//
+// Receive()
+//
+//-------------------------------------------------------------------------------------------------
+int32_t CZeroCopyReceiver::Receive( CChunk& chunk )
+{
+   chunk = {};
+
+   if ( !m_socket.IsSocketValid() )
+   {
+      m_socket.SetSocketError( CSimpleSocket::SocketInvalidSocket );
+      m_socket.m_nBytesReceived = CSimpleSocket::SocketError;
+      return m_socket.m_nBytesReceived;
+   }
+
+   if ( m_pWindow == nullptr )
+   {
+      return Copy( chunk, m_nWindowSize, 0 );
+   }
+
+   m_socket.SetSocketError( CSimpleSocket::SocketSuccess );
+   m_socket.m_timer.SetStartTime();
+
+   // Mapping replaces whatever the previous call left in the window
+   tcp_zerocopy_receive stReceive = {};
+   stReceive.address = reinterpret_cast<uint64_t>( m_pWindow );
+   stReceive.length = static_cast<uint32_t>( m_nWindowSize );
+   socklen_t nLength = sizeof( stReceive );
+
+   int nResult = 0;
+   do
+   {
+      nResult = GETSOCKOPT( m_socket.m_socket, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &stReceive, &nLength );
+   } while ( nResult == CSimpleSocket::SocketError && errno == EINTR );
+
+   m_socket.m_timer.SetEndTime();
+
+   if ( nResult == CSimpleSocket::SocketError )
+   {
+      if ( errno == EINVAL || errno == EOPNOTSUPP || errno == ENOPROTOOPT )
+      {
+         // Not available for this kernel or socket, stop trying
+         munmap( m_pWindow, m_nWindowSize );
+         m_pWindow = nullptr;
+         return Copy( chunk, m_nWindowSize, 0 );
+      }
+
+      if ( errno == EIO )
+      {
+         return Copy( chunk, m_nWindowSize, 0 );   // Remote finished and nothing is queued, report end of stream
+      }
+
+      m_socket.TranslateSocketError();
+      m_socket.m_nBytesReceived = CSimpleSocket::SocketError;
+      return m_socket.m_nBytesReceived;
+   }
+
+   chunk.nMapped = stReceive.length;
+   chunk.pMapped = ( chunk.nMapped > 0 ) ? m_pWindow : nullptr;
+
+   if ( stReceive.recv_skip_hint > 0 )
+   {
+      // These bytes sit before the next full page, or in pages which cannot be mapped
+      const size_t nRoom = m_nWindowSize - chunk.nMapped;
+      if ( nRoom > 0 && Copy( chunk, std::min<size_t>( stReceive.recv_skip_hint, nRoom ), MSG_DONTWAIT ) ==
+                            CSimpleSocket::SocketError )
+      {
+         return m_socket.m_nBytesReceived;
+      }
+   }
+   else if ( chunk.nMapped == 0 )
+   {
+      // Nothing pending, wait for data or end of stream like a regular receive would
+      return Copy( chunk, m_nWindowSize, 0 );
+   }
+
+   m_socket.m_nBytesReceived = static_cast<int32_t>( chunk.GetSize() );
+   return m_socket.m_nBytesReceived;
+}
+
+//-------------------------------------------------------------------------------------------------
+int32_t CZeroCopyReceiver::Copy( CChunk& chunk, size_t nBytes, int nFlags )
+{
+   int32_t nReceived = 0;
+   do
+   {
+      nReceived = static_cast<int32_t>( RECV( m_socket.m_socket, m_copy.data(), nBytes, nFlags ) );
+   } while ( nReceived == CSimpleSocket::SocketError && errno == EINTR );
+
+   // errno is only meaningful after a failure, a success may leave an earlier EINTR behind
+   if ( nReceived == CSimpleSocket::SocketError )
+   {
+      m_socket.TranslateSocketError();
+      m_socket.m_nBytesReceived = CSimpleSocket::SocketError;
+      return m_socket.m_nBytesReceived;
+   }
+
+   m_socket.SetSocketError( CSimpleSocket::SocketSuccess );
+   chunk.pCopied = m_copy.data();
+   chunk.nCopied = static_cast<size_t>( nReceived );
+   m_socket.m_nBytesReceived = static_cast<int32_t>( chunk.GetSize() );
+   return m_socket.m_nBytesReceived;
+}
+
+#endif   // _LINUX
@@ -0,0 +1,83 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#ifndef __ZEROCOPYRECEIVER_H__
+#define __ZEROCOPYRECEIVER_H__
+
+#ifdef _LINUX
+
+#include "SimpleSocket.h"
+
+#include <vector>
+
+/// Receives from a TCP socket by mapping the kernel's payload pages into a window of the
+/// process (TCP_ZEROCOPY_RECEIVE) rather than copying them. Whatever cannot be mapped, such
+/// as data which does not fill whole pages, is copied into a side buffer, and when the kernel
+/// or the route does not support mapping at all every byte is copied. The socket must
+/// outlive the receiver.
+class CZeroCopyReceiver
+{
+public:
+   /// Data of one Receive(), valid until the next call. Mapped data always precedes the copied.
+   struct CChunk
+   {
+      const uint8_t* pMapped = nullptr;   ///< Payload pages mapped into the window.
+      size_t nMapped = 0;
+      const uint8_t* pCopied = nullptr;   ///< Remainder which had to be copied.
+      size_t nCopied = 0;
+
+      [[nodiscard]] size_t GetSize() const { return nMapped + nCopied; }
+   };
+
+   /// @param nWindowSize largest amount mapped by a single Receive(), rounded up to whole pages.
+   explicit CZeroCopyReceiver( CSimpleSocket& socket, size_t nWindowSize = 2 * 1024 * 1024 );
+   CZeroCopyReceiver( const CZeroCopyReceiver& ) = delete;
+   CZeroCopyReceiver( CZeroCopyReceiver&& ) = delete;
+   ~CZeroCopyReceiver();
+
+   CZeroCopyReceiver& operator=( const CZeroCopyReceiver& ) = delete;
+   CZeroCopyReceiver& operator=( CZeroCopyReceiver&& ) = delete;
+
+   /// @return true while receives attempt to map pages, false once everything is copied.
+   [[nodiscard]] bool IsMapping() const { return m_pWindow != nullptr; }
+
+   /// Receive up to the window size, blocking as CSimpleSocket::Receive() would if nothing
+   /// is pending. The socket's byte count and error are updated.
+   /// @return number of bytes received, zero if the remote closed the connection or -1 on error.
+   int32_t Receive( CChunk& chunk );
+
+private:
+   int32_t Copy( CChunk& chunk, size_t nBytes, int nFlags );
+
+   CSimpleSocket& m_socket;
+   uint8_t* m_pWindow = nullptr;   /// mapping the payload pages land in
+   size_t m_nWindowSize = 0;
+   std::vector<uint8_t> m_copy;   /// holds what could not be mapped
+};
+
+#endif   // _LINUX
+
+#endif   // __ZEROCOPYRECEIVER_H__
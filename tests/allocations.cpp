@@ -0,0 +1,99 @@
+/*
+
+MIT License
+
+Copyright (c) 2018 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#define CATCH_CONFIG_MAIN   // Own executable, the allocator below replaces the one of the whole process
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+   std::atomic<size_t> nAllocations{ 0 };   // Heap allocations made by the whole process
+}
+
+void* operator new( size_t nSize )
+{
+   ++nAllocations;
+   if ( void* pMemory = std::malloc( nSize != 0 ? nSize : 1 ) )
+   {
+      return pMemory;
+   }
+
+   throw std::bad_alloc();
+}
+
+void operator delete( void* pMemory ) noexcept { std::free( pMemory ); }
+void operator delete( void* pMemory, size_t ) noexcept { std::free( pMemory ); }
+
+TEST_CASE( "socket accept churn", "[.][Benchmark][TCP]" )
+{
+   static constexpr uint8_t MSG[] = { 'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd' };
+   static constexpr auto MSG_LENGTH = ( sizeof( MSG ) / sizeof( MSG[ 0 ] ) );
+   static constexpr size_t CONNECTIONS = 256;
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   CSocketRecycler recycler;
+
+   // Allocations the server makes per connection, accepting and reading one message
+   const auto churn = [&]( CSocketRecycler* pRecycler ) {
+      size_t nServerAllocations = 0;
+      for ( size_t i = 0; i < CONNECTIONS; ++i )
+      {
+         CActiveSocket client;
+         REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+         REQUIRE( client.Send( MSG, MSG_LENGTH ) == MSG_LENGTH );
+
+         const size_t nBefore = nAllocations;
+         std::unique_ptr<CActiveSocket> pConnection = server.Accept( pRecycler );
+         pConnection->Receive( MSG_LENGTH );
+         if ( pRecycler != nullptr )
+         {
+            pRecycler->Recycle( std::move( pConnection ) );
+         }
+         nServerAllocations += nAllocations - nBefore;
+      }
+
+      return static_cast<double>( nServerAllocations ) / CONNECTIONS;
+   };
+
+   // Benchmark Results (allocations per accepted connection):
+   // allocated: 2 (socket and receive buffer)
+   // recycled: 0 (Receive() no longer builds a std::function, the recycled socket keeps its buffer)
+   const double allocated = churn( nullptr );
+   churn( &recycler );   // Warm up
+   const double recycled = churn( &recycler );
+
+   WARN( "allocated: " << allocated << " recycled: " << recycled );
+   CHECK( recycled < allocated );
+
+   BENCHMARK( "allocated" ) { return churn( nullptr ); };
+   BENCHMARK( "recycled" ) { return churn( &recycler ); };
+}
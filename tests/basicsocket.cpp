@@ -0,0 +1,160 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+#include "catch2/catch.hpp"
+#include "BasicSocket.h"
+#include "PassiveSocket.h"
+
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+   constexpr uint8_t MESSAGE[] = "compile time";
+}   // namespace
+
+TEST_CASE( "Basic sockets take over opened sockets", "[BasicSocket][TCP][UDP]" )
+{
+   SECTION( "TCP" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket client;
+      REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      CTcpSocket sender( std::move( client ) );
+      CBasicSocket<CTcpProtocol, CStatTimer> receiver( std::move( *connection ) );
+      REQUIRE_FALSE( client.IsSocketValid() );
+      REQUIRE_FALSE( connection->IsSocketValid() );
+
+      REQUIRE( sender.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+      CHECK( sender.GetSocketError() == CSimpleSocket::SocketSuccess );
+
+      uint8_t buffer[ sizeof( MESSAGE ) ] = {};
+      REQUIRE( receiver.Receive( buffer, sizeof( buffer ) ) == sizeof( MESSAGE ) );
+      CHECK( std::equal( std::begin( buffer ), std::end( buffer ), std::begin( MESSAGE ) ) );
+      CHECK( receiver.GetEndTime() >= receiver.GetStartTime() );
+
+      REQUIRE( sender.Close() );
+      REQUIRE( receiver.Receive( buffer, sizeof( buffer ) ) == 0 );
+   }
+
+   SECTION( "UDP" )
+   {
+      CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket client( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+      const uint16_t nClientPort = client.GetClientPort();
+      const uint16_t nServerPort = server.GetServerPort();
+
+      CUdpSocket sender( std::move( client ) );
+      CUdpSocket receiver( std::move( server ) );
+
+      REQUIRE( sender.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+
+      uint8_t buffer[ 64 ] = {};
+      REQUIRE( receiver.Receive( buffer, sizeof( buffer ) ) == sizeof( MESSAGE ) );
+      CHECK( ntohs( receiver.GetSource().sin_port ) == nClientPort );
+
+      // Replies go where they are sent explicitly
+      receiver.SetPeer( receiver.GetSource() );
+      REQUIRE( receiver.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+      REQUIRE( sender.Receive( buffer, sizeof( buffer ) ) == sizeof( MESSAGE ) );
+
+      // A datagram from anyone else does not redirect them
+      CActiveSocket stranger( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( stranger.Open( "127.0.0.1", nServerPort ) );
+      REQUIRE( stranger.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+      REQUIRE( receiver.Receive( buffer, sizeof( buffer ) ) == sizeof( MESSAGE ) );
+      CHECK( ntohs( receiver.GetSource().sin_port ) == stranger.GetClientPort() );
+      CHECK( ntohs( receiver.GetPeer().sin_port ) == nClientPort );
+   }
+
+   SECTION( "Errors" )
+   {
+      CActiveSocket client;
+      REQUIRE( client.SetNonblocking() );
+
+      CTcpSocket unconnected( std::move( client ) );
+      uint8_t buffer[ 16 ] = {};
+      REQUIRE( unconnected.Receive( buffer, sizeof( buffer ) ) == CSimpleSocket::SocketError );
+      CHECK( unconnected.GetSocketError() != CSimpleSocket::SocketSuccess );
+
+      CActiveSocket datagram( CSimpleSocket::SocketTypeUdp );
+      REQUIRE_THROWS_AS( CTcpSocket( std::move( datagram ) ), std::runtime_error );
+      REQUIRE( datagram.IsSocketValid() );
+
+      CActiveSocket closed;
+      REQUIRE( closed.Close() );
+      REQUIRE_THROWS_AS( CTcpSocket( std::move( closed ) ), std::runtime_error );
+   }
+
+   SECTION( "Move assignment" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket first;
+      REQUIRE( first.Open( "127.0.0.1", server.GetServerPort() ) );
+      CActiveSocket second;
+      REQUIRE( second.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      std::unique_ptr<CActiveSocket> firstConnection = server.Accept();
+      REQUIRE( firstConnection != nullptr );
+      std::unique_ptr<CActiveSocket> secondConnection = server.Accept();
+      REQUIRE( secondConnection != nullptr );
+
+      CTcpSocket sender( std::move( first ) );
+      CTcpSocket other( std::move( second ) );
+      const SOCKET handle = other.GetSocketHandle();
+
+      // The handle it held is closed, the remote sees the end of the stream
+      sender = std::move( other );
+      REQUIRE( sender.GetSocketHandle() == handle );
+      REQUIRE_FALSE( other.IsSocketValid() );
+      REQUIRE( firstConnection->Receive( 16 ) == 0 );
+
+      REQUIRE( sender.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+      REQUIRE( secondConnection->Receive( sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+
+      std::vector<CTcpSocket> sockets;
+      sockets.push_back( std::move( sender ) );
+      sockets.erase( sockets.begin() );
+      CHECK( std::is_nothrow_move_assignable<CTcpSocket>::value );
+   }
+
+   SECTION( "Policies add no state" )
+   {
+      CHECK( sizeof( CBasicSocket<CTcpProtocol, CNoTiming, CSystemErrors> ) == sizeof( SOCKET ) + 2 * sizeof( sockaddr_in ) );
+      CHECK_FALSE( std::is_polymorphic<CTcpSocket>::value );
+   }
+}
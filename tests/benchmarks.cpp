@@ -27,9 +27,17 @@ SOFTWARE.
 #define CATCH_CONFIG_ENABLE_CHRONO_STRINGMAKER
 #define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "catch2/catch.hpp"
+#include "BasicSocket.h"
 #include "PassiveSocket.h"
 
 #include <future>
+#include <thread>
+#include <vector>
+
+// Gateways hold idle connections by the hundred thousand, rarely used state belongs in CSimpleSocket::CSettings
+#if defined( _LINUX ) && defined( __x86_64__ )
+static_assert( sizeof( CActiveSocket ) <= 128, "Every connection pays for the members of CSimpleSocket" );
+#endif
 
 class benchmark_socket : CActiveSocket
 {
@@ -192,3 +200,204 @@ TEST_CASE( "socket send", "[.][Benchmark][TCP][UDP]" )
    }
 #endif
 }
+
+TEST_CASE( "basic socket send", "[.][Benchmark][TCP][UDP]" )
+{
+   static constexpr uint8_t MSG[] = { 'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd' };
+   static constexpr auto MSG_LENGTH = ( sizeof( MSG ) / sizeof( MSG[ 0 ] ) );
+
+   // Benchmark Results (loopback, the system call dominates both):
+   // TCP: simple socket ~2.2us, basic socket ~2.4us
+   // UDP: simple socket ~2.1us, basic socket ~2.4us
+   SECTION( "TCP" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+      CActiveSocket client;
+      REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+      auto connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      // Keep reading so the sends never stall on a full window
+      std::thread drain( [&] {
+         while ( connection->Receive( 64 * 1024 ) > 0 )
+         {
+         }
+      } );
+
+      CActiveSocket& dynamic = client;
+      BENCHMARK( "simple socket" ) { return dynamic.Send( MSG, MSG_LENGTH ); };
+
+      CTcpSocket socket( std::move( client ) );
+      BENCHMARK( "basic socket" ) { return socket.Send( MSG, MSG_LENGTH ); };
+
+      socket.Close();
+      drain.join();
+   }
+
+#ifndef _DARWIN
+   SECTION( "UDP" )
+   {
+      CActiveSocket client( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( client.Open( "127.0.0.1", 12345 ) );
+
+      CActiveSocket& dynamic = client;
+      BENCHMARK( "simple socket" ) { return dynamic.Send( MSG, MSG_LENGTH ); };
+
+      CUdpSocket socket( std::move( client ) );
+      BENCHMARK( "basic socket" ) { return socket.Send( MSG, MSG_LENGTH ); };
+   }
+#endif
+}
+
+TEST_CASE( "socket batch send", "[.][Benchmark][UDP]" )
+{
+   static constexpr uint8_t MSG[] = { 'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd' };
+   static constexpr auto MSG_LENGTH = ( sizeof( MSG ) / sizeof( MSG[ 0 ] ) );
+   static constexpr size_t BATCH_SIZE = 64;
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::vector<CSimpleSocket::CDatagram> datagrams( BATCH_SIZE );
+   for ( auto& datagram : datagrams )
+   {
+      datagram.stBuffer = { const_cast<uint8_t*>( MSG ), MSG_LENGTH };
+   }
+
+   // Benchmark Results (64 datagrams):
+   // one at a time: ~148us
+   // batch: ~108us
+   BENCHMARK( "one at a time" )
+   {
+      for ( size_t i = 0; i < BATCH_SIZE; ++i ) socket.Send( MSG, MSG_LENGTH );
+   };
+   BENCHMARK( "batch" ) { return socket.SendBatch( datagrams.data(), datagrams.size() ); };
+
+   CHECK( socket.Close() );
+}
+
+TEST_CASE( "socket segmented send", "[.][Benchmark][UDP]" )
+{
+   static constexpr uint16_t SEGMENT_SIZE = 1400;
+   static constexpr size_t SEGMENT_COUNT = 32;
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   const std::vector<uint8_t> payload( SEGMENT_SIZE * SEGMENT_COUNT, 'x' );
+
+   // Benchmark Results (32 segments of 1400 bytes):
+   // per datagram: ~65us
+   // segmented: ~14us
+   BENCHMARK( "per datagram" )
+   {
+      for ( size_t i = 0; i < SEGMENT_COUNT; ++i ) socket.Send( payload.data() + i * SEGMENT_SIZE, SEGMENT_SIZE );
+   };
+   BENCHMARK( "segmented" ) { return socket.SendSegmented( payload.data(), payload.size(), SEGMENT_SIZE ); };
+
+   CHECK( socket.Close() );
+}
+
+class benchmark_receiver : public CPassiveSocket
+{
+public:
+   explicit benchmark_receiver( CSocketType type = SocketTypeUdp ) : CPassiveSocket( type ) {}
+
+   // Receive into a std::string which is zero filled to nMaxBytes before every call and then trimmed
+   int32_t receiveOriginal( uint32_t nMaxBytes )
+   {
+      m_sOriginal.assign( nMaxBytes, '\0' );
+
+      uint32_t srcSize = SOCKET_ADDR_IN_SIZE;
+      m_nBytesReceived = RECVFROM( m_socket, &m_sOriginal[ 0 ], nMaxBytes, 0, GetUdpRxAddrBuffer(), &srcSize );
+      TranslateSocketError();
+
+      if ( m_nBytesReceived == SocketError )
+         m_sOriginal.clear();
+      else
+         m_sOriginal.erase( m_nBytesReceived );
+
+      return m_nBytesReceived;
+   }
+
+private:
+   std::string m_sOriginal;
+};
+
+TEST_CASE( "socket receive buffer", "[.][Benchmark][UDP]" )
+{
+   static constexpr uint8_t MSG[] = { 'H', 'e', 'l', 'l', 'o', ' ', 'W', 'o', 'r', 'l', 'd' };
+   static constexpr auto MSG_LENGTH = ( sizeof( MSG ) / sizeof( MSG[ 0 ] ) );
+   static constexpr uint32_t MAX_BYTES = 64 * 1024;
+
+   benchmark_receiver server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   // Benchmark Results (11 byte datagram, 64KiB reads):
+   // zero filled string: ~4us
+   // reused buffer: ~3us
+   BENCHMARK( "zero filled string" )
+   {
+      socket.Send( MSG, MSG_LENGTH );
+      return server.receiveOriginal( MAX_BYTES );
+   };
+   BENCHMARK( "reused buffer" )
+   {
+      socket.Send( MSG, MSG_LENGTH );
+      return server.Receive( MAX_BYTES );
+   };
+
+   CHECK( server.GetData() == "Hello World" );
+   CHECK( socket.Close() );
+}
+
+#ifdef _LINUX
+TEST_CASE( "socket footprint", "[.][Benchmark][TCP]" )
+{
+   static constexpr size_t CONNECTIONS = 400;   // Both ends are held, within the default descriptor limit
+
+   const auto residentBytes = [] {
+      size_t nTotalPages = 0;
+      size_t nResidentPages = 0;
+      FILE* pStatm = fopen( "/proc/self/statm", "r" );
+      REQUIRE( pStatm != nullptr );
+      REQUIRE( fscanf( pStatm, "%zu %zu", &nTotalPages, &nResidentPages ) == 2 );
+      fclose( pStatm );
+      return nResidentPages * static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+   };
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   std::vector<std::unique_ptr<CActiveSocket>> clients;
+   std::vector<std::unique_ptr<CActiveSocket>> connections;
+   clients.reserve( CONNECTIONS );
+   connections.reserve( CONNECTIONS );
+
+   const size_t nBefore = residentBytes();
+   for ( size_t i = 0; i < CONNECTIONS; ++i )
+   {
+      clients.push_back( std::make_unique<CActiveSocket>() );
+      REQUIRE( clients.back()->Open( "127.0.0.1", server.GetServerPort() ) );
+      connections.push_back( server.Accept() );
+      REQUIRE( connections.back() != nullptr );
+   }
+   const size_t nAfter = residentBytes();
+
+   // Benchmark Results (user space bytes per idle connection, both ends):
+   // sizeof: 128 (192 with the settings inline)
+   // resident: ~310
+   WARN( "sizeof: " << sizeof( CActiveSocket )
+                    << " resident: " << ( nAfter - nBefore ) / ( 2 * CONNECTIONS ) );
+}
+#endif
@@ -0,0 +1,187 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+#include "catch2/catch.hpp"
+#include "ConnectionPool.h"
+#include "PassiveSocket.h"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE( "Connection pool reuses connections", "[ConnectionPool][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   const uint16_t nPort = server.GetServerPort();
+
+   CConnectionPool pool( 0, 2 );
+
+   std::unique_ptr<CActiveSocket> pClient = pool.Acquire( "127.0.0.1", nPort );
+   REQUIRE( pClient != nullptr );
+   std::unique_ptr<CActiveSocket> pRemote = server.Accept();
+   REQUIRE( pRemote != nullptr );
+
+   const uint16_t nClientPort = pClient->GetClientPort();
+   pool.Release( "127.0.0.1", nPort, std::move( pClient ) );
+   REQUIRE( pool.GetIdleCount( "127.0.0.1", nPort ) == 1 );
+
+   SECTION( "Idle connection" )
+   {
+      pClient = pool.Acquire( "127.0.0.1", nPort );
+      REQUIRE( pClient != nullptr );
+      CHECK( pClient->GetClientPort() == nClientPort );
+      CHECK( pool.GetOpenedCount() == 1 );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 0 );
+
+      const uint8_t message[] = "ping";
+      REQUIRE( pClient->Send( message, sizeof( message ) ) == sizeof( message ) );
+      REQUIRE( pRemote->Receive( sizeof( message ) ) == sizeof( message ) );
+   }
+
+   SECTION( "Closed by the remote" )
+   {
+      pRemote->Close();
+      std::this_thread::sleep_for( 10ms );
+
+      pClient = pool.Acquire( "127.0.0.1", nPort );
+      REQUIRE( pClient != nullptr );
+      CHECK( pClient->GetClientPort() != nClientPort );
+      CHECK( pool.GetOpenedCount() == 2 );
+   }
+
+   SECTION( "Unexpected data" )
+   {
+      const uint8_t message[] = "unsolicited";
+      REQUIRE( pRemote->Send( message, sizeof( message ) ) == sizeof( message ) );
+      std::this_thread::sleep_for( 10ms );
+
+      pClient = pool.Acquire( "127.0.0.1", nPort );
+      REQUIRE( pClient != nullptr );
+      CHECK( pClient->GetClientPort() != nClientPort );
+   }
+
+   SECTION( "Other endpoint" )
+   {
+      CHECK( pool.GetIdleCount( "localhost", nPort ) == 0 );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort + 1 ) == 0 );
+   }
+}
+
+TEST_CASE( "Connection pool is bounded", "[ConnectionPool][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   const uint16_t nPort = server.GetServerPort();
+
+   SECTION( "Maximum idle" )
+   {
+      CConnectionPool pool( 0, 2 );
+
+      std::vector<std::unique_ptr<CActiveSocket>> clients;
+      for ( int i = 0; i < 3; ++i )
+      {
+         clients.push_back( pool.Acquire( "127.0.0.1", nPort ) );
+         REQUIRE( clients.back() != nullptr );
+      }
+
+      for ( auto& pClient : clients )
+      {
+         pool.Release( "127.0.0.1", nPort, std::move( pClient ) );
+      }
+
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 2 );
+   }
+
+   SECTION( "Failed connection" )
+   {
+      CConnectionPool pool;
+
+      pool.Release( "127.0.0.1", nPort, nullptr );
+      pool.Release( "127.0.0.1", nPort, std::make_unique<CActiveSocket>() );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 0 );
+
+      server.Close();
+      CHECK( pool.Acquire( "127.0.0.1", nPort ) == nullptr );
+      CHECK( pool.GetLastError() == CSimpleSocket::SocketConnectionRefused );
+      CHECK( pool.GetOpenedCount() == 0 );
+   }
+}
+
+TEST_CASE( "Connection pool warms and evicts", "[ConnectionPool][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   const uint16_t nPort = server.GetServerPort();
+
+   CConnectionPool pool( 2, 4, 20ms );
+
+   REQUIRE( pool.Warm( "127.0.0.1", nPort ) == 2 );
+   REQUIRE( pool.Warm( "127.0.0.1", nPort ) == 2 );
+   CHECK( pool.GetOpenedCount() == 2 );
+
+   SECTION( "Keeps the minimum" )
+   {
+      std::unique_ptr<CActiveSocket> pExtra = pool.Acquire( "127.0.0.1", nPort );
+      std::unique_ptr<CActiveSocket> pOther = pool.Acquire( "127.0.0.1", nPort );
+      std::unique_ptr<CActiveSocket> pNew = pool.Acquire( "127.0.0.1", nPort );
+      REQUIRE( pNew != nullptr );
+      CHECK( pool.GetOpenedCount() == 3 );
+
+      pool.Release( "127.0.0.1", nPort, std::move( pExtra ) );
+      pool.Release( "127.0.0.1", nPort, std::move( pOther ) );
+      std::this_thread::sleep_for( 30ms );
+      pool.Release( "127.0.0.1", nPort, std::move( pNew ) );
+
+      CHECK( pool.Evict() == 1 );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 2 );
+      CHECK( pool.Evict() == 0 );
+   }
+
+   SECTION( "Past the idle timeout" )
+   {
+      std::this_thread::sleep_for( 30ms );
+
+      std::unique_ptr<CActiveSocket> pClient = pool.Acquire( "127.0.0.1", nPort );
+      REQUIRE( pClient != nullptr );
+      CHECK( pool.GetOpenedCount() == 3 );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 0 );
+   }
+
+   SECTION( "Closed by the remote" )
+   {
+      for ( int i = 0; i < 2; ++i )
+      {
+         std::unique_ptr<CActiveSocket> pRemote = server.Accept();
+         REQUIRE( pRemote != nullptr );
+      }
+      std::this_thread::sleep_for( 10ms );
+
+      CHECK( pool.Evict() == 2 );
+      CHECK( pool.GetIdleCount( "127.0.0.1", nPort ) == 0 );
+   }
+}
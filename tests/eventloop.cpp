@@ -0,0 +1,222 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "catch2/catch.hpp"
+#include "EventLoop.h"
+#include "PassiveSocket.h"
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#ifdef _LINUX
+
+using namespace std::string_view_literals;
+static constexpr auto EVENT_PACKET = "Event Loop"sv;
+
+TEST_CASE( "Event loop rejects bad registrations", "[EventLoop]" )
+{
+   CEventLoop loop;
+   CSimpleSocket socket;
+   const auto handler = []( CSimpleSocket&, uint32_t ) {};
+
+   SECTION( "Missing handler" )
+   {
+      REQUIRE_FALSE( loop.Register( socket, CEventLoop::EventRead, nullptr ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+   }
+
+   SECTION( "Duplicate registration" )
+   {
+      REQUIRE( loop.Register( socket, CEventLoop::EventRead, handler ) );
+      REQUIRE_FALSE( loop.Register( socket, CEventLoop::EventWrite, handler ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+      REQUIRE( loop.GetRegisteredCount() == 1 );
+      REQUIRE( loop.Unregister( socket ) );
+   }
+
+   SECTION( "Invalid socket" )
+   {
+      CSimpleSocket secondary = std::move( socket );
+      REQUIRE_FALSE( loop.Register( socket, CEventLoop::EventRead, handler ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidSocket );
+   }
+
+   SECTION( "Unknown socket" )
+   {
+      REQUIRE_FALSE( loop.Modify( socket, CEventLoop::EventWrite ) );
+      REQUIRE_FALSE( loop.Unregister( socket ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+   }
+
+   REQUIRE( loop.GetRegisteredCount() == 0 );
+}
+
+TEST_CASE( "Event loop can echo", "[EventLoop][Listen][Accept][TCP]" )
+{
+   CEventLoop loop;
+   CPassiveSocket server;
+   std::vector<std::unique_ptr<CActiveSocket>> connections;
+   size_t nEchoed = 0;
+
+   REQUIRE( server.SetNonblocking() );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   const auto echo = [&]( CSimpleSocket& connection, uint32_t nEvents ) {
+      if ( ( nEvents & CEventLoop::EventError ) == 0 && connection.Receive( 1024 ) > 0 )
+      {
+         connection.Send( reinterpret_cast<const uint8_t*>( connection.GetData().data() ),
+                          connection.GetBytesReceived() );
+         ++nEchoed;
+         return;
+      }
+
+      loop.Unregister( connection );   // Remote closed, stop watching
+   };
+
+   REQUIRE( loop.Register( server, CEventLoop::EventRead, [&]( CSimpleSocket&, uint32_t ) {
+      while ( auto connection = server.Accept() )
+      {
+         REQUIRE( connection->SetNonblocking() );
+         REQUIRE( loop.Register( *connection, CEventLoop::EventRead, echo ) );
+         connections.emplace_back( std::move( connection ) );
+      }
+   } ) );
+
+   CActiveSocket alpha;
+   CActiveSocket beta;
+   REQUIRE( alpha.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( beta.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   while ( connections.size() < 2 )
+   {
+      REQUIRE( loop.RunOnce( 1000 ) > 0 );
+   }
+
+   REQUIRE( loop.GetRegisteredCount() == 3 );
+
+   REQUIRE( alpha.Send( EVENT_PACKET ) == EVENT_PACKET.length() );
+   REQUIRE( beta.Send( EVENT_PACKET ) == EVENT_PACKET.length() );
+
+   while ( nEchoed < 2 )
+   {
+      REQUIRE( loop.RunOnce( 1000 ) > 0 );
+   }
+
+   REQUIRE( alpha.Receive( 1024 ) == EVENT_PACKET.length() );
+   REQUIRE( alpha.GetData() == EVENT_PACKET );
+
+   REQUIRE( beta.Receive( 1024 ) == EVENT_PACKET.length() );
+   REQUIRE( beta.GetData() == EVENT_PACKET );
+
+   REQUIRE( alpha.Close() );
+   REQUIRE( loop.RunOnce( 1000 ) == 1 );
+   REQUIRE( loop.GetRegisteredCount() == 2 );
+
+   REQUIRE( loop.Unregister( server ) );
+   REQUIRE( loop.GetRegisteredCount() == 1 );
+}
+
+TEST_CASE( "Event loop skips events of replaced registrations", "[EventLoop][UDP]" )
+{
+   CEventLoop loop;
+   std::unique_ptr<CPassiveSocket> servers[ 2 ];
+   CActiveSocket clients[ 2 ] = { CActiveSocket( CSimpleSocket::SocketTypeUdp ),
+                                  CActiveSocket( CSimpleSocket::SocketTypeUdp ) };
+
+   for ( size_t i = 0; i < 2; ++i )
+   {
+      servers[ i ] = std::make_unique<CPassiveSocket>( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( servers[ i ]->Listen( "127.0.0.1", 0 ) );
+      REQUIRE( clients[ i ].Open( "127.0.0.1", servers[ i ]->GetServerPort() ) );
+   }
+
+   // Whichever handler runs first closes the other socket and registers a new one, which most
+   // likely reuses its handle. The closed socket's event in the same batch must not reach it.
+   std::unique_ptr<CPassiveSocket> replacement;
+   int32_t nStale = 0;
+   const auto handler = [&]( CSimpleSocket& socket, uint32_t ) {
+      if ( replacement != nullptr ) return;
+
+      auto& other = ( &socket == servers[ 0 ].get() ) ? servers[ 1 ] : servers[ 0 ];
+      REQUIRE( loop.Unregister( *other ) );
+      other.reset();
+
+      replacement = std::make_unique<CPassiveSocket>( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( loop.Register( *replacement, CEventLoop::EventRead, [&]( CSimpleSocket&, uint32_t ) { ++nStale; } ) );
+   };
+
+   for ( size_t i = 0; i < 2; ++i )
+   {
+      REQUIRE( loop.Register( *servers[ i ], CEventLoop::EventRead, handler ) );
+      REQUIRE( clients[ i ].Send( EVENT_PACKET ) == EVENT_PACKET.length() );
+      REQUIRE( servers[ i ]->Select( CSimpleSocket::ReadinessReadable, 1, 0 ) );
+   }
+
+   REQUIRE( loop.RunOnce( 1000 ) == 1 );
+   REQUIRE( nStale == 0 );
+}
+
+TEST_CASE( "Event loop survives throwing handlers", "[EventLoop][UDP]" )
+{
+   CEventLoop loop;
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket client( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( client.Send( EVENT_PACKET ) == EVENT_PACKET.length() );
+
+   const auto state = std::make_shared<int>( 0 );
+   REQUIRE( loop.Register( server, CEventLoop::EventRead,
+                           [state]( CSimpleSocket&, uint32_t ) { throw std::runtime_error( "handler" ); } ) );
+   REQUIRE_THROWS_AS( loop.RunOnce( 1000 ), std::runtime_error );
+
+   // Outside a dispatch the handler is released right away rather than kept for one to finish
+   REQUIRE( loop.Unregister( server ) );
+   REQUIRE( state.use_count() == 1 );
+}
+
+TEST_CASE( "Event loop can be stopped", "[EventLoop]" )
+{
+   CEventLoop loop;
+
+   SECTION( "Idle loop" )
+   {
+      REQUIRE( loop.RunOnce( 0 ) == 0 );
+   }
+
+   SECTION( "From another thread" )
+   {
+      auto running = std::async( std::launch::async, [&] { loop.Run(); } );
+      loop.Stop();
+      REQUIRE( running.wait_for( std::chrono::seconds( 5 ) ) == std::future_status::ready );
+   }
+}
+
+#endif
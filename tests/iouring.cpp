@@ -0,0 +1,222 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "catch2/catch.hpp"
+#include "IoUring.h"
+
+#include <array>
+#include <string_view>
+
+using namespace std::string_view_literals;
+static constexpr auto URING_PACKET = "Submission Queue"sv;
+
+namespace
+{
+   enum Tags : uint64_t
+   {
+      TagAccept = 1,
+      TagOpen,
+      TagSend,
+      TagReceive
+   };
+
+   std::vector<CIoUring::CCompletion> WaitFor( CIoUring& ring, size_t nExpected )
+   {
+      std::vector<CIoUring::CCompletion> completions;
+      while ( completions.size() < nExpected )
+      {
+         const auto nRemaining = static_cast<uint32_t>( nExpected - completions.size() );
+         REQUIRE( ring.WaitCompletions( completions, nRemaining, 5000 ) > 0 );
+      }
+
+      return completions;
+   }
+
+   const CIoUring::CCompletion& Find( const std::vector<CIoUring::CCompletion>& completions, uint64_t nTag )
+   {
+      const auto itor = std::find_if( completions.begin(), completions.end(),
+                                      [nTag]( const CIoUring::CCompletion& c ) { return c.nTag == nTag; } );
+      REQUIRE( itor != completions.end() );
+      return *itor;
+   }
+
+   std::string_view AsView( const uint8_t* pData, int32_t nLength )
+   {
+      return { reinterpret_cast<const char*>( pData ), static_cast<size_t>( nLength ) };
+   }
+}
+
+TEST_CASE( "io_uring requests complete", "[IoUring][Listen][Open][Accept][TCP]" )
+{
+   const auto mode = GENERATE( CIoUring::ModeAutomatic, CIoUring::ModeSynchronous );
+   CIoUring ring( 64, mode );
+
+   if ( mode == CIoUring::ModeSynchronous ) REQUIRE_FALSE( ring.IsAvailable() );
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket client;
+
+   // Connect first, the synchronous fallback carries requests out in order and accept blocks
+   REQUIRE( ring.Open( client, "127.0.0.1", server.GetServerPort(), TagOpen ) );
+   REQUIRE( ring.Accept( server, TagAccept ) );
+   REQUIRE( ring.GetPendingCount() == 2 );
+   REQUIRE( ring.Submit() >= 0 );
+
+   auto completions = WaitFor( ring, 2 );
+   REQUIRE( ring.GetPendingCount() == 0 );
+
+   const auto& opened = Find( completions, TagOpen );
+   REQUIRE( opened.nOperation == CIoUring::OperationConnect );
+   REQUIRE( opened.nResult == CSimpleSocket::SocketSuccess );
+   REQUIRE( client.GetSocketError() == CSimpleSocket::SocketSuccess );
+   CHECK( client.GetServerPort() == server.GetServerPort() );
+
+   auto& accepted = const_cast<CIoUring::CCompletion&>( Find( completions, TagAccept ) );
+   REQUIRE( accepted.pAccepted != nullptr );
+   std::unique_ptr<CActiveSocket> connection = std::move( accepted.pAccepted );
+   REQUIRE( connection->IsSocketValid() );
+   CHECK( connection->GetClientPort() == client.GetClientPort() );
+   CHECK( connection->GetServerPort() == server.GetServerPort() );
+
+   SECTION( "Send and Receive" )
+   {
+      std::array<uint8_t, 64> buffer{};
+
+      REQUIRE( ring.Send( client, reinterpret_cast<const uint8_t*>( URING_PACKET.data() ), URING_PACKET.length(),
+                          TagSend ) );
+      REQUIRE( ring.Receive( *connection, buffer.data(), buffer.size(), TagReceive ) );
+
+      completions = WaitFor( ring, 2 );
+
+      REQUIRE( Find( completions, TagSend ).nResult == URING_PACKET.length() );
+      REQUIRE( client.GetBytesSent() == URING_PACKET.length() );
+
+      const auto& received = Find( completions, TagReceive );
+      REQUIRE( received.nResult == URING_PACKET.length() );
+      REQUIRE( connection->GetBytesReceived() == URING_PACKET.length() );
+      REQUIRE( AsView( buffer.data(), received.nResult ) == URING_PACKET );
+   }
+
+   SECTION( "Fixed files and registered buffers" )
+   {
+      std::array<uint8_t, 64> outbound{};
+      std::array<uint8_t, 64> inbound{};
+      std::copy( URING_PACKET.begin(), URING_PACKET.end(), outbound.begin() );
+
+      const std::array<iovec, 2> buffers = { iovec{ outbound.data(), outbound.size() },
+                                              iovec{ inbound.data(), inbound.size() } };
+
+      REQUIRE( ring.RegisterSocket( client ) );
+      REQUIRE( ring.RegisterSocket( *connection ) );
+      REQUIRE( ring.RegisterBuffers( buffers.data(), buffers.size() ) );
+
+      REQUIRE( ring.SendRegistered( client, 0, 0, URING_PACKET.length(), TagSend ) );
+      REQUIRE( ring.ReceiveRegistered( *connection, 1, 0, inbound.size(), TagReceive ) );
+
+      completions = WaitFor( ring, 2 );
+
+      REQUIRE( Find( completions, TagSend ).nResult == URING_PACKET.length() );
+      REQUIRE( Find( completions, TagReceive ).nResult == URING_PACKET.length() );
+      REQUIRE( AsView( inbound.data(), URING_PACKET.length() ) == URING_PACKET );
+
+      CHECK_FALSE( ring.SendRegistered( client, 2, 0, 1, TagSend ) );
+      CHECK( client.GetSocketError() == CSimpleSocket::SocketInvalidPointer );
+
+      REQUIRE( ring.UnregisterSocket( client ) );
+      REQUIRE( ring.UnregisterSocket( *connection ) );
+   }
+
+   SECTION( "Pooled receive" )
+   {
+      static constexpr uint32_t BUFFER_SIZE = 32;
+      std::array<uint8_t, BUFFER_SIZE * 4> pool{};
+      REQUIRE( ring.ProvideBuffers( pool.data(), BUFFER_SIZE, 4 ) );
+
+      REQUIRE( ring.ReceivePooled( *connection, TagReceive, true ) );
+      REQUIRE( client.Send( URING_PACKET ) == URING_PACKET.length() );
+
+      completions = WaitFor( ring, 1 );
+      const auto& first = Find( completions, TagReceive );
+      REQUIRE( first.nResult == URING_PACKET.length() );
+      REQUIRE( first.nBufferId >= 0 );
+      REQUIRE( AsView( first.pData, first.nResult ) == URING_PACKET );
+      REQUIRE( first.bMore == ring.SupportsMultishot() );
+      REQUIRE( ring.RecycleBuffer( first.nBufferId ) );
+
+      if ( !first.bMore )
+      {
+         REQUIRE( ring.ReceivePooled( *connection, TagReceive, true ) );   // Re-arm
+      }
+
+      REQUIRE( client.Send( URING_PACKET ) == URING_PACKET.length() );
+
+      completions = WaitFor( ring, 1 );
+      const auto& second = Find( completions, TagReceive );
+      REQUIRE( second.nResult == URING_PACKET.length() );
+      REQUIRE( AsView( second.pData, second.nResult ) == URING_PACKET );
+
+      REQUIRE( connection->Shutdown( CSimpleSocket::Both ) );
+      if ( second.bMore )
+      {
+         completions = WaitFor( ring, 1 );   // Multishot ends with the connection
+         REQUIRE_FALSE( Find( completions, TagReceive ).bMore );
+      }
+   }
+
+   REQUIRE( ring.GetPendingCount() == 0 );
+}
+
+TEST_CASE( "io_uring rejects bad requests", "[IoUring]" )
+{
+   CIoUring ring( 8 );
+   CActiveSocket socket;
+
+   SECTION( "Invalid socket" )
+   {
+      CActiveSocket secondary = std::move( socket );
+      REQUIRE_FALSE( ring.Send( socket, reinterpret_cast<const uint8_t*>( URING_PACKET.data() ), 1, TagSend ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidSocket );
+   }
+
+   SECTION( "Invalid buffer" )
+   {
+      REQUIRE_FALSE( ring.Receive( socket, nullptr, 1, TagReceive ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidPointer );
+      REQUIRE_FALSE( ring.ReceivePooled( socket, TagReceive ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidPointer );
+   }
+
+   SECTION( "Accept on datagram socket" )
+   {
+      CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+      REQUIRE_FALSE( ring.Accept( server, TagAccept ) );
+      REQUIRE( server.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+
+   REQUIRE( ring.GetPendingCount() == 0 );
+}
@@ -256,6 +256,38 @@ TEST_CASE( "Sockets dont leak" )
    }
 }
 
+TEST_CASE( "Sockets adopt handles", "[Initialization][TCP]" )
+{
+   SECTION( "Existing handle" )
+   {
+      const SOCKET handle = socket( AF_INET, SOCK_STREAM, 0 );
+      REQUIRE( handle != INVALID_SOCKET );
+
+      CActiveSocket socket( handle, CSimpleSocket::SocketTypeTcp );
+      CHECK( socket.IsSocketValid() );
+      CHECK( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+      CHECK( socket.GetSocketType() == CSimpleSocket::SocketTypeTcp );
+      REQUIRE( socket.Close() );
+   }
+
+   SECTION( "Deferred handle" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket( INVALID_SOCKET, CSimpleSocket::SocketTypeTcp );
+      CHECK_FALSE( socket.IsSocketValid() );
+      CHECK( socket.GetSocketError() == CSimpleSocket::SocketInvalidSocket );
+
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+      CHECK( socket.IsSocketValid() );
+
+      REQUIRE( socket.Close() );
+      REQUIRE_FALSE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+      CHECK( socket.GetSocketError() == CSimpleSocket::SocketInvalidSocket );
+   }
+}
+
 TEST_CASE( "Socket errors produce descriptions" )
 {
    const auto code = GENERATE(
@@ -0,0 +1,124 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "Relay.h"
+
+#include <future>
+#include <string>
+
+#ifdef _LINUX
+
+TEST_CASE( "Relays forward both directions", "[Relay][Listen][Open][Accept][TCP]" )
+{
+   static constexpr size_t REQUEST_SIZE = 2 * 1024 * 1024;   // Much more than a pipe holds
+   const std::string request( REQUEST_SIZE, 'q' );
+   const std::string response = "Relayed Response";
+
+   // client -> frontend ... relay ... backend -> upstream
+   CPassiveSocket frontendServer;
+   CPassiveSocket upstreamServer;
+   REQUIRE( frontendServer.Listen( "127.0.0.1", 0 ) );
+   REQUIRE( upstreamServer.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket client;
+   REQUIRE( client.Open( "127.0.0.1", frontendServer.GetServerPort() ) );
+   std::unique_ptr<CActiveSocket> frontend = frontendServer.Accept();
+   REQUIRE( frontend != nullptr );
+
+   CActiveSocket backend;
+   REQUIRE( backend.Open( "127.0.0.1", upstreamServer.GetServerPort() ) );
+   std::unique_ptr<CActiveSocket> upstream = upstreamServer.Accept();
+   REQUIRE( upstream != nullptr );
+
+   CRelay relay( *frontend, backend );
+   REQUIRE( frontend->IsNonblocking() );
+   REQUIRE( backend.IsNonblocking() );
+
+   auto relaying = std::async( std::launch::async, [&] { return relay.Run(); } );
+
+   // Upstream reads the whole request, which ends with the client's half close, then answers
+   auto serving = std::async( std::launch::async, [&] {
+      std::string received;
+      while ( upstream->Receive( 64 * 1024 ) > 0 )
+      {
+         received += upstream->GetData();
+      }
+
+      upstream->Send( response );
+      upstream->Close();
+      return received;
+   } );
+
+   REQUIRE( client.Send( request ) == request.length() );
+   REQUIRE( client.Shutdown( CSimpleSocket::Sends ) );
+
+   std::string answer;
+   while ( client.Receive( 1024 ) > 0 )
+   {
+      answer += client.GetData();
+   }
+
+   REQUIRE( serving.get() == request );
+   REQUIRE( answer == response );
+
+   REQUIRE( relaying.wait_for( std::chrono::seconds( 5 ) ) == std::future_status::ready );
+   REQUIRE( relaying.get() );
+   REQUIRE( relay.IsFinished() );
+   REQUIRE( relay.GetBytesForwarded() == request.length() );
+   REQUIRE( relay.GetBytesReturned() == response.length() );
+}
+
+TEST_CASE( "Relays can be polled", "[Relay][Listen][Open][Accept][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket left;
+   CActiveSocket right;
+   REQUIRE( left.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( right.Open( "127.0.0.1", server.GetServerPort() ) );
+   std::unique_ptr<CActiveSocket> leftPeer = server.Accept();
+   std::unique_ptr<CActiveSocket> rightPeer = server.Accept();
+   REQUIRE( leftPeer != nullptr );
+   REQUIRE( rightPeer != nullptr );
+
+   CRelay relay( *leftPeer, *rightPeer );
+   REQUIRE( relay.RunOnce( 0 ) == 0 );
+
+   REQUIRE( left.Send( "ping" ) == 4 );
+   while ( relay.GetBytesForwarded() < 4 )
+   {
+      REQUIRE( relay.RunOnce( 1000 ) >= 0 );
+   }
+
+   REQUIRE( right.Receive( 16 ) == 4 );
+   REQUIRE( right.GetData() == "ping" );
+   REQUIRE_FALSE( relay.IsFinished() );
+}
+
+#endif
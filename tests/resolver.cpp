@@ -0,0 +1,320 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "Resolver.h"
+#include "ResolverCache.h"
+#include "SocketSet.h"
+
+#include <array>
+
+namespace
+{
+   /// Read the next query sent to the stub name server.
+   std::vector<uint8_t> ReceiveQuery( CPassiveSocket& server )
+   {
+      REQUIRE( server.Select( CSimpleSocket::ReadinessReadable, 1, 0 ) );
+
+      std::array<uint8_t, 512> buffer{};
+      const int32_t nReceived = server.Receive( buffer.size(), buffer.data() );
+      REQUIRE( nReceived > 12 );
+      return { buffer.begin(), buffer.begin() + nReceived };
+   }
+
+   /// Build the reply to a query with address records, the header and question are echoed back.
+   std::vector<uint8_t> Reply( std::vector<uint8_t> message, uint8_t nCode,
+                               const std::vector<std::array<uint8_t, 4>>& addresses, uint32_t nTtl = 60 )
+   {
+      message[ 2 ] = 0x81;   // Response, recursion desired
+      message[ 3 ] = static_cast<uint8_t>( 0x80 | nCode );
+      message[ 7 ] = static_cast<uint8_t>( addresses.size() );
+
+      for ( const auto& address : addresses )
+      {
+         const uint8_t record[] = { 0xC0,
+                                    0x0C,   // Name of the question
+                                    0,
+                                    1,   // A
+                                    0,
+                                    1,   // IN
+                                    static_cast<uint8_t>( nTtl >> 24 ),
+                                    static_cast<uint8_t>( nTtl >> 16 ),
+                                    static_cast<uint8_t>( nTtl >> 8 ),
+                                    static_cast<uint8_t>( nTtl ),
+                                    0,
+                                    4 };
+         message.insert( message.end(), std::begin( record ), std::end( record ) );
+         message.insert( message.end(), address.begin(), address.end() );
+      }
+
+      return message;
+   }
+
+   /// Reply to a query over the stub name server's datagram socket.
+   void Answer( CPassiveSocket& server, const std::vector<uint8_t>& query, uint8_t nCode,
+                const std::vector<std::array<uint8_t, 4>>& addresses, uint32_t nTtl = 60 )
+   {
+      const auto message = Reply( query, nCode, addresses, nTtl );
+      REQUIRE( server.Send( message.data(), message.size() ) == static_cast<int32_t>( message.size() ) );
+   }
+
+   int32_t WaitAndProcess( CResolver& resolver )
+   {
+      CSocketSet sockets;
+      for ( const CResolver::CWatch& watch : resolver.GetSockets() )
+      {
+         REQUIRE( sockets.Add( *watch.pSocket, watch.nInterest ) );
+      }
+
+      sockets.WaitAny( resolver.GetTimeoutMs() );
+      return resolver.Process();
+   }
+
+   struct CResult
+   {
+      int32_t nCalls = 0;
+      CSimpleSocket::CSocketError nError = CSimpleSocket::SocketEunknown;
+      std::vector<in_addr> hosts;
+   };
+}   // namespace
+
+TEST_CASE( "Resolver queries a name server", "[Resolver][UDP]" )
+{
+   CResolverCache::GetShared().Clear();
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CResolver resolver( "127.0.0.1", server.GetServerPort() );
+   CResult result;
+   const auto callback = [&result]( CSimpleSocket::CSocketError nError, const std::vector<in_addr>& hosts ) {
+      ++result.nCalls;
+      result.nError = nError;
+      result.hosts = hosts;
+   };
+
+   std::vector<in_addr> cached;
+
+   SECTION( "Addresses" )
+   {
+      REQUIRE( resolver.Resolve( "service.test", callback ) );
+      REQUIRE( resolver.GetPendingCount() == 1 );
+
+      const auto query = ReceiveQuery( server );
+      const std::string sQuestion( query.begin() + 12, query.end() );
+      REQUIRE( sQuestion.find( "service" ) != std::string::npos );
+
+      Answer( server, query, 0, { { 10, 0, 0, 1 }, { 10, 0, 0, 2 } } );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+
+      REQUIRE( result.nCalls == 1 );
+      REQUIRE( result.nError == CSimpleSocket::SocketSuccess );
+      REQUIRE( result.hosts.size() == 2 );
+      CHECK( result.hosts[ 1 ].s_addr == htonl( 0x0A000002 ) );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+
+      REQUIRE( CResolverCache::GetShared().Find( "service.test", cached ) == CResolverCache::LookupFound );
+      REQUIRE( resolver.Resolve( "service.test", callback ) );   // Answered from the cache
+      REQUIRE( result.nCalls == 2 );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+   }
+
+   SECTION( "Name does not exist" )
+   {
+      REQUIRE( resolver.Resolve( "missing.test", callback ) );
+      Answer( server, ReceiveQuery( server ), 3, {} );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+
+      REQUIRE( result.nError == CSimpleSocket::SocketInvalidAddress );
+      REQUIRE( CResolverCache::GetShared().Find( "missing.test", cached ) == CResolverCache::LookupFailed );
+   }
+
+   SECTION( "Server failure is not cached" )
+   {
+      REQUIRE( resolver.Resolve( "broken.test", callback ) );
+      Answer( server, ReceiveQuery( server ), 2, {} );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+
+      REQUIRE( result.nError == CSimpleSocket::SocketProtocolError );
+      REQUIRE( CResolverCache::GetShared().Find( "broken.test", cached ) == CResolverCache::LookupMiss );
+   }
+
+   SECTION( "Unexpected answers are dropped" )
+   {
+      REQUIRE( resolver.Resolve( "service.test", callback ) );
+      const auto query = ReceiveQuery( server );
+
+      auto forged = query;
+      forged[ 0 ] ^= 0xFF;
+      Answer( server, forged, 0, { { 10, 0, 0, 9 } } );
+      REQUIRE( WaitAndProcess( resolver ) == 0 );
+      REQUIRE( resolver.GetPendingCount() == 1 );
+
+      Answer( server, query, 0, { { 10, 0, 0, 1 } } );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+      REQUIRE( result.hosts.front().s_addr == htonl( 0x0A000001 ) );
+   }
+
+   SECTION( "Every query has its own port" )
+   {
+      REQUIRE( resolver.Resolve( "first.test", callback ) );
+      REQUIRE( resolver.Resolve( "second.test", callback ) );
+
+      const auto sockets = resolver.GetSockets();
+      REQUIRE( sockets.size() == 2 );
+      CHECK( sockets[ 0 ].pSocket->GetClientPort() != sockets[ 1 ].pSocket->GetClientPort() );
+   }
+
+   SECTION( "Truncated answers are asked again over TCP" )
+   {
+      CPassiveSocket stream;
+      REQUIRE( stream.Listen( "127.0.0.1", server.GetServerPort() ) );
+
+      REQUIRE( resolver.Resolve( "large.test", callback ) );
+      const auto query = ReceiveQuery( server );
+
+      auto truncated = Reply( query, 0, {} );
+      truncated[ 2 ] |= 0x02;   // TC
+      REQUIRE( server.Send( truncated.data(), truncated.size() ) == static_cast<int32_t>( truncated.size() ) );
+      REQUIRE( WaitAndProcess( resolver ) == 0 );
+
+      std::unique_ptr<CActiveSocket> connection = stream.Accept();
+      REQUIRE( connection != nullptr );
+      while ( resolver.GetSockets().front().nInterest != CSimpleSocket::ReadinessReadable )
+      {
+         WaitAndProcess( resolver );
+      }
+
+      std::array<uint8_t, 2> length{};
+      REQUIRE( connection->ReceiveExactly( length.data(), length.size(), 1000 ) == 2 );
+      std::vector<uint8_t> asked( ( length[ 0 ] << 8 ) | length[ 1 ] );
+      REQUIRE( connection->ReceiveExactly( asked.data(), asked.size(), 1000 ) == static_cast<int32_t>( asked.size() ) );
+      REQUIRE( asked == query );
+
+      const auto reply = Reply( query, 0, { { 10, 0, 0, 7 } } );
+      std::vector<uint8_t> framed = { 0, static_cast<uint8_t>( reply.size() ) };
+      framed.insert( framed.end(), reply.begin(), reply.end() );
+      REQUIRE( connection->Send( framed.data(), framed.size() ) == static_cast<int32_t>( framed.size() ) );
+
+      while ( result.nCalls == 0 ) WaitAndProcess( resolver );
+      REQUIRE( result.nError == CSimpleSocket::SocketSuccess );
+      REQUIRE( result.hosts.front().s_addr == htonl( 0x0A000007 ) );
+   }
+
+   SECTION( "Retries then times out" )
+   {
+      resolver.SetTimeout( 50, 2 );
+      REQUIRE( resolver.Resolve( "silent.test", callback ) );
+
+      const auto first = ReceiveQuery( server );
+      while ( result.nCalls == 0 ) WaitAndProcess( resolver );
+      const auto second = ReceiveQuery( server );
+
+      REQUIRE( first == second );   // Same question and identifier
+      REQUIRE( result.nError == CSimpleSocket::SocketTimedout );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+      REQUIRE( resolver.GetTimeoutMs() == -1 );
+   }
+
+   SECTION( "Literal address" )
+   {
+      REQUIRE( resolver.Resolve( "10.1.2.3", callback ) );
+      REQUIRE( result.nCalls == 1 );
+      REQUIRE( result.hosts.front().s_addr == htonl( 0x0A010203 ) );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+   }
+
+   SECTION( "Invalid name" )
+   {
+      REQUIRE_FALSE( resolver.Resolve( "bad..name", callback ) );
+      REQUIRE( resolver.GetSocketError() == CSimpleSocket::SocketInvalidAddress );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+   }
+
+   CResolverCache::GetShared().Clear();
+}
+
+TEST_CASE( "Resolver opens connections", "[Resolver][Open][TCP]" )
+{
+   CResolverCache::GetShared().Clear();
+
+   CPassiveSocket nameserver( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( nameserver.Listen( "127.0.0.1", 0 ) );
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CResolver resolver( "127.0.0.1", nameserver.GetServerPort() );
+   CActiveSocket socket;
+
+   int32_t nCalls = 0;
+   CSimpleSocket::CSocketError nError = CSimpleSocket::SocketEunknown;
+   const auto callback = [&]( CSimpleSocket::CSocketError nResult ) {
+      ++nCalls;
+      nError = nResult;
+   };
+
+   SECTION( "Non-blocking" )
+   {
+      REQUIRE( socket.SetNonblocking() );
+      REQUIRE( resolver.Open( socket, "backend.test", server.GetServerPort(), callback ) );
+      REQUIRE( nCalls == 0 );
+
+      Answer( nameserver, ReceiveQuery( nameserver ), 0, { { 127, 0, 0, 1 } } );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+
+      REQUIRE( nCalls == 1 );
+      REQUIRE( ( nError == CSimpleSocket::SocketEinprogress || nError == CSimpleSocket::SocketSuccess ) );
+      REQUIRE( socket.Select( CSimpleSocket::ReadinessWritable, 1, 0 ) );
+      REQUIRE( socket.GetServerPort() == server.GetServerPort() );
+
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+      CHECK( connection->GetClientPort() == socket.GetClientPort() );
+   }
+
+   SECTION( "Name does not exist" )
+   {
+      REQUIRE( socket.SetNonblocking() );
+      REQUIRE( resolver.Open( socket, "missing.test", server.GetServerPort(), callback ) );
+
+      Answer( nameserver, ReceiveQuery( nameserver ), 3, {} );
+      REQUIRE( WaitAndProcess( resolver ) == 1 );
+      REQUIRE( nError == CSimpleSocket::SocketInvalidAddress );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidAddress );
+   }
+
+   SECTION( "Blocking socket" )
+   {
+      REQUIRE_FALSE( resolver.Open( socket, "backend.test", server.GetServerPort(), callback ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+      REQUIRE( resolver.GetPendingCount() == 0 );
+   }
+
+   CResolverCache::GetShared().Clear();
+}
@@ -0,0 +1,164 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "ResolverCache.h"
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+   in_addr MakeHost( const char* pAddr )
+   {
+      in_addr stHost = {};
+      REQUIRE( inet_pton( AF_INET, pAddr, &stHost ) == 1 );
+      return stHost;
+   }
+}   // namespace
+
+TEST_CASE( "Resolver cache remembers lookups", "[ResolverCache]" )
+{
+   CResolverCache cache;
+   std::vector<in_addr> hosts;
+
+   REQUIRE( cache.Find( "example.test", hosts ) == CResolverCache::LookupMiss );
+
+   SECTION( "Addresses" )
+   {
+      cache.Store( "example.test", { MakeHost( "10.0.0.1" ), MakeHost( "10.0.0.2" ) } );
+      REQUIRE( cache.Find( "example.test", hosts ) == CResolverCache::LookupFound );
+      REQUIRE( hosts.size() == 2 );
+      REQUIRE( hosts[ 1 ].s_addr == MakeHost( "10.0.0.2" ).s_addr );
+   }
+
+   SECTION( "Failures" )
+   {
+      cache.Store( "example.test", {} );
+      REQUIRE( cache.Find( "example.test", hosts ) == CResolverCache::LookupFailed );
+   }
+
+   SECTION( "Expiry" )
+   {
+      cache.SetTimeToLive( 20ms, 0ms );
+      cache.Store( "example.test", { MakeHost( "10.0.0.1" ) } );
+      cache.Store( "failed.test", {} );
+      REQUIRE( cache.GetSize() == 1 );
+
+      std::this_thread::sleep_for( 30ms );
+      REQUIRE( cache.Find( "example.test", hosts ) == CResolverCache::LookupMiss );
+      REQUIRE( cache.GetSize() == 0 );
+   }
+
+   SECTION( "Invalidate" )
+   {
+      cache.Store( "example.test", { MakeHost( "10.0.0.1" ) } );
+      cache.Store( "other.test", { MakeHost( "10.0.0.2" ) } );
+
+      cache.Invalidate( "example.test" );
+      REQUIRE( cache.Find( "example.test", hosts ) == CResolverCache::LookupMiss );
+      REQUIRE( cache.GetSize() == 1 );
+
+      cache.Clear();
+      REQUIRE( cache.GetSize() == 0 );
+   }
+
+   SECTION( "Capacity" )
+   {
+      CResolverCache small( 2 );
+      small.Store( "first.test", { MakeHost( "10.0.0.1" ) } );
+      std::this_thread::sleep_for( 1ms );
+      small.Store( "second.test", { MakeHost( "10.0.0.2" ) } );
+      small.Store( "third.test", { MakeHost( "10.0.0.3" ) } );
+
+      REQUIRE( small.GetSize() == 2 );
+      REQUIRE( small.Find( "first.test", hosts ) == CResolverCache::LookupMiss );
+      REQUIRE( small.Find( "third.test", hosts ) == CResolverCache::LookupFound );
+   }
+
+   SECTION( "Capacity evicts the oldest" )
+   {
+      // The failure expires first but was stored last
+      CResolverCache small( 2 );
+      small.Store( "first.test", { MakeHost( "10.0.0.1" ) } );
+      std::this_thread::sleep_for( 1ms );
+      small.Store( "failed.test", {} );
+      std::this_thread::sleep_for( 1ms );
+      small.Store( "third.test", { MakeHost( "10.0.0.3" ) } );
+
+      REQUIRE( small.GetSize() == 2 );
+      REQUIRE( small.Find( "first.test", hosts ) == CResolverCache::LookupMiss );
+      REQUIRE( small.Find( "failed.test", hosts ) == CResolverCache::LookupFailed );
+   }
+}
+
+TEST_CASE( "Sockets open through the resolver cache", "[ResolverCache][Open][TCP]" )
+{
+   CResolverCache& cache = CResolverCache::GetShared();
+   cache.Clear();
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   std::vector<in_addr> hosts;
+
+   SECTION( "Cached name skips the resolver" )
+   {
+      // The .invalid domain never resolves, so only the cache can answer
+      cache.Store( "server.invalid", { MakeHost( "127.0.0.1" ) } );
+      REQUIRE( socket.Open( "server.invalid", server.GetServerPort() ) );
+      REQUIRE( socket.GetServerAddr() == "127.0.0.1" );
+   }
+
+   SECTION( "Cached failure" )
+   {
+      cache.Store( "localhost", {} );
+      REQUIRE_FALSE( socket.Open( "localhost", server.GetServerPort() ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidAddress );
+
+      cache.Invalidate( "localhost" );
+      REQUIRE( socket.Open( "localhost", server.GetServerPort() ) );
+   }
+
+   SECTION( "Lookups are stored" )
+   {
+      REQUIRE( socket.Open( "localhost", server.GetServerPort() ) );
+      REQUIRE( cache.Find( "localhost", hosts ) == CResolverCache::LookupFound );
+      REQUIRE( hosts.front().s_addr == MakeHost( "127.0.0.1" ).s_addr );
+   }
+
+   SECTION( "Literal addresses bypass the cache" )
+   {
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+      REQUIRE( cache.GetSize() == 0 );
+   }
+
+   cache.Clear();
+}
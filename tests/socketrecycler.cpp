@@ -0,0 +1,108 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "SocketRecycler.h"
+
+namespace
+{
+   class CDerivedSocket : public CActiveSocket
+   {
+   };
+}   // namespace
+
+TEST_CASE( "Socket recyclers reuse accepted sockets", "[SocketRecycler][Listen][Accept][TCP]" )
+{
+   static constexpr uint8_t MESSAGE[] = "recycled";
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CSocketRecycler recycler( 1 );
+
+   CActiveSocket first;
+   REQUIRE( first.Open( "127.0.0.1", server.GetServerPort() ) );
+   std::unique_ptr<CActiveSocket> pAccepted = server.Accept( &recycler );
+   REQUIRE( pAccepted != nullptr );
+
+   REQUIRE( first.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+   REQUIRE( pAccepted->Receive( sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+   REQUIRE( pAccepted->SetNonblocking() );
+   REQUIRE( pAccepted->SetReceiveTimeout( 1, 0 ) );
+
+   const CActiveSocket* pObject = pAccepted.get();
+   recycler.Recycle( std::move( pAccepted ) );
+   REQUIRE( recycler.GetSize() == 1 );
+
+   SECTION( "Closes the connection" )
+   {
+      REQUIRE( first.Receive( sizeof( MESSAGE ) ) == 0 );
+   }
+
+   SECTION( "Resets the state" )
+   {
+      CActiveSocket second;
+      REQUIRE( second.Open( "127.0.0.1", server.GetServerPort() ) );
+      pAccepted = server.Accept( &recycler );
+      REQUIRE( pAccepted != nullptr );
+
+      CHECK( pAccepted.get() == pObject );
+      CHECK( recycler.GetSize() == 0 );
+
+      CHECK( pAccepted->IsSocketValid() );
+      CHECK( pAccepted->GetSocketError() == CSimpleSocket::SocketSuccess );
+      CHECK( pAccepted->GetClientPort() == second.GetClientPort() );
+      CHECK_FALSE( pAccepted->IsNonblocking() );
+      CHECK( pAccepted->GetReceiveTimeoutSec() == 0 );
+      CHECK( pAccepted->GetBytesReceived() == -1 );
+      CHECK( pAccepted->GetData().empty() );
+
+      REQUIRE( second.Send( MESSAGE, sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+      REQUIRE( pAccepted->Receive( sizeof( MESSAGE ) ) == sizeof( MESSAGE ) );
+   }
+
+   SECTION( "Batches" )
+   {
+      CActiveSocket second;
+      REQUIRE( second.Open( "127.0.0.1", server.GetServerPort() ) );
+      REQUIRE( server.SetNonblocking() );
+
+      std::vector<std::unique_ptr<CActiveSocket>> accepted;
+      REQUIRE( server.AcceptBatch( accepted, CPassiveSocket::ACCEPT_BATCH_SIZE, &recycler ) == 1 );
+      CHECK( accepted.front().get() == pObject );
+      CHECK( accepted.front()->IsNonblocking() );
+   }
+
+   SECTION( "Capacity" )
+   {
+      recycler.Recycle( std::make_unique<CActiveSocket>() );
+      recycler.Recycle( std::make_unique<CDerivedSocket>() );
+      recycler.Recycle( nullptr );
+      CHECK( recycler.GetSize() == 1 );
+   }
+}
@@ -0,0 +1,125 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "SocketSet.h"
+
+#include <string_view>
+
+using namespace std::string_view_literals;
+static constexpr auto SET_PACKET = "Socket Set"sv;
+
+TEST_CASE( "Socket sets track members", "[SocketSet]" )
+{
+   CSocketSet set;
+   CSimpleSocket socket;
+
+   REQUIRE( set.Add( socket ) );
+   REQUIRE( set.Add( socket, CSimpleSocket::ReadinessWritable ) );
+   REQUIRE( set.GetSize() == 1 );
+
+   SECTION( "Remove" )
+   {
+      REQUIRE( set.Remove( socket ) );
+      REQUIRE_FALSE( set.Remove( socket ) );
+   }
+
+   SECTION( "Clear" )
+   {
+      set.Clear();
+   }
+
+   SECTION( "Invalid socket" )
+   {
+      REQUIRE( set.Remove( socket ) );
+      CSimpleSocket secondary = std::move( socket );
+      REQUIRE_FALSE( set.Add( socket ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidSocket );
+   }
+
+   REQUIRE( set.GetSize() == 0 );
+   REQUIRE( set.WaitAny( 0 ) == 0 );
+   REQUIRE( set.WaitAll( 0 ) );
+}
+
+TEST_CASE( "Socket sets wait on many sockets", "[SocketSet][Listen][Open][Accept][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket alpha;
+   CActiveSocket beta;
+   REQUIRE( alpha.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( beta.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> first = server.Accept();
+   std::unique_ptr<CActiveSocket> second = server.Accept();
+   REQUIRE( first != nullptr );
+   REQUIRE( second != nullptr );
+
+   CSocketSet set;
+   REQUIRE( set.Add( *first ) );
+   REQUIRE( set.Add( *second ) );
+
+   REQUIRE( set.WaitAny( 0 ) == 0 );
+   REQUIRE( set.GetReady().empty() );
+
+   REQUIRE( alpha.Send( SET_PACKET ) == SET_PACKET.length() );
+
+   SECTION( "Any" )
+   {
+      REQUIRE( set.WaitAny( 1000 ) == 1 );
+      REQUIRE( set.GetReady().size() == 1 );
+      CHECK( set.GetReady().front().nReadiness == CSimpleSocket::ReadinessReadable );
+
+      CSimpleSocket& ready = *set.GetReady().front().pSocket;
+      REQUIRE( ready.GetReadiness() == CSimpleSocket::ReadinessReadable );
+      REQUIRE( ready.Receive( 1024 ) == SET_PACKET.length() );
+      REQUIRE( ready.GetData() == SET_PACKET );
+      REQUIRE( ready.GetClientPort() == alpha.GetClientPort() );
+   }
+
+   SECTION( "All" )
+   {
+      REQUIRE_FALSE( set.WaitAll( 50 ) );
+      REQUIRE( set.GetReady().size() == 1 );
+
+      REQUIRE( beta.Send( SET_PACKET ) == SET_PACKET.length() );
+
+      REQUIRE( set.WaitAll( 1000 ) );
+      REQUIRE( set.GetReady().size() == 2 );
+      REQUIRE( set.GetReady()[ 0 ].pSocket == first.get() );
+      REQUIRE( set.GetReady()[ 1 ].pSocket == second.get() );
+   }
+
+   SECTION( "Mixed interest" )
+   {
+      REQUIRE( set.Add( *second, CSimpleSocket::ReadinessWritable ) );
+      REQUIRE( set.WaitAll( 1000 ) );
+      REQUIRE( set.GetReady()[ 1 ].nReadiness == CSimpleSocket::ReadinessWritable );
+   }
+}
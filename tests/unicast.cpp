@@ -27,14 +27,19 @@ SOFTWARE.
 #include "catch2/catch.hpp"
 #include "PassiveSocket.h"
 
+#include <array>
+#include <cstdio>
 #include <future>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include <Ws2tcpip.h>
 #elif defined( _LINUX ) || defined( _DARWIN )
 #include <netdb.h>
 #include <netinet/ip.h>
+#include <sys/resource.h>
 #endif
 
 using namespace std::chrono_literals;
@@ -714,6 +719,169 @@ TEST_CASE( "Receive a huge message", "[!mayfail][TCP]" )
                Catch::StartsWith( "HTTP/1.0 200 OK\r\n" ) && Catch::Contains( "\r\n\r\n<!doctype html>" ) );
 }
 
+namespace
+{
+   class CRacingSocket : public CActiveSocket
+   {
+   public:
+      using CActiveSocket::ConnectRacing;
+   };
+
+   sockaddr_in MakeLoopback( uint16_t nPort )
+   {
+      sockaddr_in stAddr = {};
+      stAddr.sin_family = AF_INET;
+      stAddr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+      stAddr.sin_port = htons( nPort );
+      return stAddr;
+   }
+}   // namespace
+
+TEST_CASE( "Sockets can race addresses", "[Open][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   const sockaddr_in live = MakeLoopback( server.GetServerPort() );
+
+   // Nothing listens on a port which was just released, connecting is refused
+   uint16_t nRefusedPort = 0;
+   {
+      CPassiveSocket closed;
+      REQUIRE( closed.Listen( "127.0.0.1", 0 ) );
+      nRefusedPort = closed.GetServerPort();
+   }
+   const sockaddr_in refused = MakeLoopback( nRefusedPort );
+
+   // With its accept queue full a listener drops further handshakes, so connecting stalls
+   CPassiveSocket stalled;
+   REQUIRE( stalled.Listen( "127.0.0.1", 0, 0 ) );
+   CActiveSocket filler;
+   REQUIRE( filler.Open( "127.0.0.1", stalled.GetServerPort() ) );
+   const sockaddr_in unresponsive = MakeLoopback( stalled.GetServerPort() );
+
+   CRacingSocket socket;
+   const auto start = std::chrono::steady_clock::now();
+
+   SECTION( "Refused address is skipped" )
+   {
+      REQUIRE( socket.ConnectRacing( { refused, live }, CActiveSocket::ATTEMPT_DELAY_MS ) );
+      CHECK( std::chrono::steady_clock::now() - start < std::chrono::milliseconds( CActiveSocket::ATTEMPT_DELAY_MS ) );
+      REQUIRE( server.Accept() != nullptr );
+   }
+
+   SECTION( "Unresponsive address is raced" )
+   {
+      REQUIRE( socket.ConnectRacing( { unresponsive, live }, 50 ) );
+      CHECK( std::chrono::steady_clock::now() - start >= 50ms );
+      REQUIRE( server.Accept() != nullptr );
+      REQUIRE_FALSE( socket.IsNonblocking() );
+      REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+   }
+
+   SECTION( "All addresses fail" )
+   {
+      REQUIRE_FALSE( socket.ConnectRacing( { refused }, CActiveSocket::ATTEMPT_DELAY_MS ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketConnectionRefused );
+   }
+
+   SECTION( "Connect timeout bounds the race" )
+   {
+      socket.SetConnectTimeout( 0, 200000 );
+      REQUIRE_FALSE( socket.ConnectRacing( { unresponsive, unresponsive }, 50 ) );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketTimedout );
+      CHECK( std::chrono::steady_clock::now() - start >= 200ms );
+   }
+
+   SECTION( "Open by name" )
+   {
+      REQUIRE( socket.Open( "localhost", server.GetServerPort(), CActiveSocket::OpenRaceAddresses ) );
+      REQUIRE( socket.GetServerPort() == server.GetServerPort() );
+      REQUIRE_FALSE( socket.IsNonblocking() );
+      REQUIRE( server.Accept() != nullptr );
+   }
+}
+
+TEST_CASE( "Sockets can accept in batches", "[Listen][Accept][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   std::vector<CActiveSocket> clients( 3 );
+   for ( CActiveSocket& client : clients )
+   {
+      REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+   }
+
+   std::vector<std::unique_ptr<CActiveSocket>> accepted;
+
+   SECTION( "Drains the backlog" )
+   {
+      REQUIRE( server.SetNonblocking() );
+      REQUIRE( server.AcceptBatch( accepted ) == clients.size() );
+      REQUIRE( server.GetSocketError() == CSimpleSocket::SocketSuccess );
+
+      for ( size_t i = 0; i < clients.size(); ++i )
+      {
+         CHECK( accepted[ i ]->IsNonblocking() );
+         CHECK( accepted[ i ]->GetClientPort() == clients[ i ].GetClientPort() );
+         CHECK( accepted[ i ]->GetServerPort() == server.GetServerPort() );
+      }
+
+      REQUIRE( clients[ 0 ].Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+      REQUIRE( accepted[ 0 ]->Select( CSimpleSocket::ReadinessReadable, 1, 0 ) );
+      REQUIRE( accepted[ 0 ]->Receive( TEXT_PACKET_LENGTH ) == TEXT_PACKET_LENGTH );
+
+      REQUIRE( server.AcceptBatch( accepted ) == 0 );
+      REQUIRE( server.GetSocketError() == CSimpleSocket::SocketEwouldblock );
+   }
+
+   SECTION( "Limit" )
+   {
+      REQUIRE( server.SetNonblocking() );
+      REQUIRE( server.AcceptBatch( accepted, 2 ) == 2 );
+      REQUIRE( server.AcceptBatch( accepted, 2 ) == 1 );
+      REQUIRE( accepted.size() == clients.size() );
+   }
+
+   SECTION( "Blocking listener" )
+   {
+      REQUIRE( server.AcceptBatch( accepted ) == clients.size() );
+      REQUIRE_FALSE( server.IsNonblocking() );
+   }
+
+   SECTION( "Datagram listener" )
+   {
+      CPassiveSocket datagram( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( datagram.AcceptBatch( accepted ) == 0 );
+      REQUIRE( datagram.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+}
+
+TEST_CASE( "Accepting does not leak descriptors", "[Listen][Accept][TCP]" )
+{
+   // The lowest free descriptor is handed out first, a leak moves it up
+   const auto nextDescriptor = [] {
+      const SOCKET probe = socket( AF_INET, SOCK_STREAM, 0 );
+      CLOSE( probe );
+      return probe;
+   };
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   const SOCKET before = nextDescriptor();
+
+   for ( int i = 0; i < 4; ++i )
+   {
+      CActiveSocket client;
+      REQUIRE( client.Open( "127.0.0.1", server.GetServerPort() ) );
+      std::unique_ptr<CActiveSocket> accepted = server.Accept();
+      REQUIRE( accepted != nullptr );
+      CHECK( accepted->GetClientPort() == client.GetClientPort() );
+   }
+
+   CHECK( nextDescriptor() == before );
+}
+
 TEST_CASE( "Sockets have remotes information", "[!mayfail][TCP]" )
 {
    CActiveSocket socket;
@@ -1406,6 +1574,616 @@ TEST_CASE( "Sockets clear buffer on Rx fail", "[Listen][Open][Accept][TCP]" )
    CHECK_FALSE( server.IsSocketValid() );
 }
 
+TEST_CASE( "Sockets can select", "[Select][Listen][Open][Accept][TCP]" )
+{
+#ifdef _LINUX
+   // Leaves the process as it found it, even when a REQUIRE bails out of the test
+   struct CReserved
+   {
+      std::vector<int> descriptors;
+      rlimit stOriginal = {};
+      bool bRaised = false;
+
+      ~CReserved()
+      {
+         for ( const int nReserved : descriptors ) close( nReserved );
+         if ( bRaised ) setrlimit( RLIMIT_NOFILE, &stOriginal );
+      }
+   } reserved;
+
+   SECTION( "Beyond FD_SETSIZE" )
+   {
+      // Occupy the low descriptors so the sockets below are numbered past what an fd_set can hold
+      REQUIRE( getrlimit( RLIMIT_NOFILE, &reserved.stOriginal ) == 0 );
+      if ( reserved.stOriginal.rlim_max < FD_SETSIZE + 64 )
+      {
+         WARN( "Descriptor limit too low to exceed FD_SETSIZE" );
+         return;
+      }
+
+      rlimit stLimit = reserved.stOriginal;
+      stLimit.rlim_cur = std::max<rlim_t>( stLimit.rlim_cur, FD_SETSIZE + 64 );
+      REQUIRE( setrlimit( RLIMIT_NOFILE, &stLimit ) == 0 );
+      reserved.bRaised = true;
+
+      while ( reserved.descriptors.size() < FD_SETSIZE )
+      {
+         const int nReserved = dup( STDIN_FILENO );
+         REQUIRE( nReserved >= 0 );
+         reserved.descriptors.push_back( nReserved );
+      }
+   }
+
+   SECTION( "Default descriptors" ) {}
+#endif
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.SetNonblocking() );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( socket.Select( CSimpleSocket::ReadinessWritable, 1, 0 ) );
+   REQUIRE( socket.GetReadiness() == CSimpleSocket::ReadinessWritable );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   REQUIRE_FALSE( connection->Select( CSimpleSocket::ReadinessReadable, 0, 1000 ) );
+   REQUIRE( connection->GetSocketError() == CSimpleSocket::SocketTimedout );
+   REQUIRE( connection->GetReadiness() == CSimpleSocket::ReadinessNone );
+
+   REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+
+   REQUIRE( connection->Select( CSimpleSocket::ReadinessReadable, 1, 0 ) );
+   REQUIRE( connection->GetReadiness() == CSimpleSocket::ReadinessReadable );
+
+   REQUIRE( connection->Select( 1, 0 ) );
+   REQUIRE( connection->GetReadiness() ==
+            ( CSimpleSocket::ReadinessReadable | CSimpleSocket::ReadinessWritable ) );
+
+   REQUIRE( connection->Receive( 1024 ) == TEXT_PACKET_LENGTH );
+   REQUIRE( connection->GetData() == TEXT_PACKET );
+}
+
+TEST_CASE( "Sockets can scatter and gather", "[Send][Receive][TCP][UDP]" )
+{
+   static constexpr auto HEADER = "HEAD"sv;
+
+   std::array<char, 4> header{};
+   std::array<char, 32> body{};
+   std::array<iovec, 2> outbound = { iovec{ const_cast<char*>( HEADER.data() ), HEADER.length() },
+                                     iovec{ const_cast<char*>( TEXT_PACKET.data() ), TEXT_PACKET_LENGTH } };
+   std::array<iovec, 2> inbound = { iovec{ header.data(), header.size() }, iovec{ body.data(), body.size() } };
+
+   SECTION( "TCP" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket;
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      REQUIRE( socket.Send( outbound.data(), outbound.size() ) == HEADER.length() + TEXT_PACKET_LENGTH );
+      REQUIRE( socket.GetBytesSent() == HEADER.length() + TEXT_PACKET_LENGTH );
+
+      REQUIRE( connection->Receive( inbound.data(), inbound.size() ) == HEADER.length() + TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetBytesReceived() == HEADER.length() + TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetData().empty() );
+   }
+
+   SECTION( "UDP" )
+   {
+      CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      REQUIRE( socket.Send( outbound.data(), outbound.size() ) == HEADER.length() + TEXT_PACKET_LENGTH );
+      REQUIRE( server.Receive( inbound.data(), inbound.size() ) == HEADER.length() + TEXT_PACKET_LENGTH );
+      CHECK( server.GetClientPort() == socket.GetClientPort() );
+   }
+
+   REQUIRE( std::string_view( header.data(), header.size() ) == HEADER );
+   REQUIRE( std::string_view( body.data(), TEXT_PACKET_LENGTH ) == TEXT_PACKET );
+}
+
+TEST_CASE( "Sockets can transfer whole blocks", "[Send][Receive][TCP]" )
+{
+   static constexpr size_t BLOCK_SIZE = 4 * 1024 * 1024;
+
+   std::vector<uint8_t> outbound( BLOCK_SIZE );
+   for ( size_t i = 0; i < outbound.size(); ++i ) outbound[ i ] = static_cast<uint8_t>( i * 13 );
+   std::vector<uint8_t> inbound( BLOCK_SIZE );
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   SECTION( "Blocking" )
+   {
+      auto sender = std::async( std::launch::async, [&] { return socket.SendAll( outbound.data(), outbound.size() ); } );
+
+      REQUIRE( connection->ReceiveExactly( inbound.data(), inbound.size() ) == BLOCK_SIZE );
+      REQUIRE( sender.get() == BLOCK_SIZE );
+      REQUIRE( socket.GetBytesSent() == BLOCK_SIZE );
+      REQUIRE( connection->GetBytesReceived() == BLOCK_SIZE );
+      REQUIRE( inbound == outbound );
+   }
+
+   SECTION( "Non-blocking with deadline" )
+   {
+      REQUIRE( socket.SetNonblocking() );
+      REQUIRE( connection->SetNonblocking() );
+
+      auto sender =
+          std::async( std::launch::async, [&] { return socket.SendAll( outbound.data(), outbound.size(), 5000 ); } );
+
+      REQUIRE( connection->ReceiveExactly( inbound.data(), inbound.size(), 5000 ) == BLOCK_SIZE );
+      REQUIRE( sender.get() == BLOCK_SIZE );
+      REQUIRE( inbound == outbound );
+   }
+
+   SECTION( "Internal buffer" )
+   {
+      REQUIRE( socket.SendAll( reinterpret_cast<const uint8_t*>( TEXT_PACKET.data() ), TEXT_PACKET_LENGTH ) ==
+               TEXT_PACKET_LENGTH );
+      REQUIRE( connection->ReceiveExactly( nullptr, TEXT_PACKET_LENGTH ) == TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetData() == TEXT_PACKET );
+   }
+
+   SECTION( "Deadline passes" )
+   {
+      REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+
+      const auto start = std::chrono::steady_clock::now();
+      REQUIRE( connection->ReceiveExactly( inbound.data(), TEXT_PACKET_LENGTH * 2, 100 ) == TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetSocketError() == CSimpleSocket::SocketTimedout );
+      CHECK( std::chrono::steady_clock::now() - start >= 100ms );
+      CHECK_FALSE( connection->IsNonblocking() );
+   }
+
+   SECTION( "Remote closes" )
+   {
+      REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+      REQUIRE( socket.Close() );
+
+      REQUIRE( connection->ReceiveExactly( inbound.data(), TEXT_PACKET_LENGTH * 2 ) == TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetSocketError() == CSimpleSocket::SocketSuccess );
+      REQUIRE( connection->ReceiveExactly( inbound.data(), TEXT_PACKET_LENGTH ) == 0 );
+   }
+
+   SECTION( "Datagrams" )
+   {
+      CActiveSocket datagram( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( datagram.SendAll( outbound.data(), 1 ) == CSimpleSocket::SocketError );
+      REQUIRE( datagram.GetSocketError() == CSimpleSocket::SocketProtocolError );
+      REQUIRE( datagram.ReceiveExactly( inbound.data(), 1 ) == CSimpleSocket::SocketError );
+      REQUIRE( datagram.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+}
+
+TEST_CASE( "Sockets can send and receive from two threads", "[Send][Receive][TCP][UDP]" )
+{
+   static constexpr size_t STREAM_SIZE = 1024 * 1024;
+
+   SECTION( "TCP" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket;
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      // Stream in both directions at once, each side sending from one thread and receiving in another
+      const auto send = []( CSimpleSocket& sender ) {
+         std::vector<uint8_t> chunk( 16 * 1024, 'x' );
+         size_t nSent = 0;
+         while ( nSent < STREAM_SIZE )
+         {
+            const CSimpleSocket::CTransfer result = sender.TrySend( chunk.data(), std::min( chunk.size(), STREAM_SIZE - nSent ) );
+            if ( !result ) break;
+            nSent += result.nBytes;
+         }
+         return nSent;
+      };
+      const auto receive = []( CSimpleSocket& receiver ) {
+         std::vector<uint8_t> chunk( 16 * 1024 );
+         size_t nReceived = 0;
+         while ( nReceived < STREAM_SIZE )
+         {
+            const CSimpleSocket::CTransfer result = receiver.TryReceive( chunk.data(), static_cast<uint32_t>( chunk.size() ) );
+            if ( !result || result.nBytes == 0 ) break;
+            nReceived += result.nBytes;
+         }
+         return nReceived;
+      };
+
+      auto socketSends = std::async( std::launch::async, send, std::ref( socket ) );
+      auto socketReceives = std::async( std::launch::async, receive, std::ref( socket ) );
+      auto connectionSends = std::async( std::launch::async, send, std::ref( *connection ) );
+      CHECK( receive( *connection ) == STREAM_SIZE );
+
+      CHECK( socketSends.get() == STREAM_SIZE );
+      CHECK( socketReceives.get() == STREAM_SIZE );
+      CHECK( connectionSends.get() == STREAM_SIZE );
+
+      // Nothing was recorded on the sockets themselves
+      CHECK( socket.GetBytesSent() == -1 );
+      CHECK( socket.GetBytesReceived() == -1 );
+      CHECK( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+   }
+
+   SECTION( "Errors" )
+   {
+      CActiveSocket socket;
+      REQUIRE( socket.SetNonblocking() );
+
+      uint8_t buffer[ 16 ] = {};
+      const CSimpleSocket::CTransfer result = socket.TryReceive( buffer, sizeof( buffer ) );
+      CHECK_FALSE( result );
+      CHECK( result.nBytes == CSimpleSocket::SocketError );
+      CHECK( result.error == CSimpleSocket::SocketNotconnected );
+      CHECK( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+
+      CHECK( socket.TrySend( nullptr, 1 ).error == CSimpleSocket::SocketInvalidPointer );
+      CHECK( socket.TryReceive( buffer, 0 ).error == CSimpleSocket::SocketInvalidPointer );
+
+      REQUIRE( socket.Close() );
+      CHECK( socket.TrySend( reinterpret_cast<const uint8_t*>( TEXT_PACKET.data() ), TEXT_PACKET.size() ).error == CSimpleSocket::SocketInvalidSocket );
+   }
+
+   SECTION( "UDP" )
+   {
+      CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      const CSimpleSocket::CTransfer sent = socket.TrySend( reinterpret_cast<const uint8_t*>( TEXT_PACKET.data() ), TEXT_PACKET.size() );
+      REQUIRE( sent );
+      REQUIRE( sent.nBytes == TEXT_PACKET_LENGTH );
+
+      uint8_t buffer[ 64 ] = {};
+      sockaddr_in stSource = {};
+      const CSimpleSocket::CTransfer received = server.TryReceive( buffer, sizeof( buffer ), &stSource );
+      REQUIRE( received );
+      REQUIRE( received.nBytes == TEXT_PACKET_LENGTH );
+      CHECK( ntohs( stSource.sin_port ) == socket.GetClientPort() );
+      CHECK( server.GetClientPort() == 0 );
+   }
+}
+
+TEST_CASE( "Sockets can batch datagrams", "[Send][Receive][UDP]" )
+{
+   static constexpr size_t BATCH_SIZE = 80;   // More than fit in one system call
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::vector<std::string> payloads( BATCH_SIZE );
+   std::vector<CSimpleSocket::CDatagram> outbound( BATCH_SIZE );
+   for ( size_t i = 0; i < BATCH_SIZE; ++i )
+   {
+      payloads[ i ] = std::string( TEXT_PACKET ) + " " + std::to_string( i );
+      outbound[ i ].stBuffer = { payloads[ i ].data(), payloads[ i ].length() };
+   }
+
+   REQUIRE( socket.SendBatch( outbound.data(), outbound.size() ) == BATCH_SIZE );
+   REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+   REQUIRE( outbound.back().nLength == payloads.back().length() );
+
+   std::vector<std::array<char, 64>> buffers( BATCH_SIZE );
+   std::vector<CSimpleSocket::CDatagram> inbound( BATCH_SIZE );
+   for ( size_t i = 0; i < BATCH_SIZE; ++i )
+   {
+      inbound[ i ].stBuffer = { buffers[ i ].data(), buffers[ i ].size() };
+   }
+
+   size_t nReceived = 0;
+   while ( nReceived < BATCH_SIZE )
+   {
+      const int32_t nBatch = server.ReceiveBatch( inbound.data() + nReceived, BATCH_SIZE - nReceived );
+      REQUIRE( nBatch > 0 );
+      nReceived += nBatch;
+   }
+
+   for ( size_t i = 0; i < BATCH_SIZE; ++i )
+   {
+      REQUIRE( std::string_view( buffers[ i ].data(), inbound[ i ].nLength ) == payloads[ i ] );
+      REQUIRE( ntohs( inbound[ i ].stAddr.sin_port ) == socket.GetClientPort() );
+   }
+
+   CHECK( server.GetClientPort() == socket.GetClientPort() );
+
+   SECTION( "Explicit destination" )
+   {
+      CPassiveSocket other( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( other.Listen( "127.0.0.1", 0 ) );
+
+      CSimpleSocket::CDatagram datagram;
+      datagram.stBuffer = outbound.front().stBuffer;
+      datagram.stAddr.sin_family = AF_INET;
+      datagram.stAddr.sin_port = htons( other.GetServerPort() );
+      datagram.stAddr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+      CActiveSocket unconnected( CSimpleSocket::SocketTypeUdp );
+      REQUIRE( unconnected.SendBatch( &datagram, 1 ) == 1 );
+      REQUIRE( other.Receive( 64 ) == payloads.front().length() );
+   }
+
+   SECTION( "Stream sockets" )
+   {
+      CActiveSocket stream;
+      REQUIRE( stream.SendBatch( outbound.data(), 1 ) == CSimpleSocket::SocketError );
+      REQUIRE( stream.GetSocketError() == CSimpleSocket::SocketProtocolError );
+      REQUIRE( stream.ReceiveBatch( inbound.data(), 1 ) == CSimpleSocket::SocketError );
+      REQUIRE( stream.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+}
+
+TEST_CASE( "Sockets can send segmented", "[Send][UDP]" )
+{
+   static constexpr uint16_t SEGMENT_SIZE = 100;
+   static constexpr size_t SEGMENT_COUNT = 150;   // More than one offloaded send can carry
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+   REQUIRE( server.SetReceiveWindowSize( 1 << 20 ) > 0 );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   // Every segment is filled with its index, the last one is shorter
+   std::vector<uint8_t> payload( SEGMENT_SIZE * SEGMENT_COUNT + SEGMENT_SIZE / 2 );
+   for ( size_t i = 0; i < payload.size(); ++i ) payload[ i ] = static_cast<uint8_t>( i / SEGMENT_SIZE );
+
+   REQUIRE( socket.SendSegmented( payload.data(), payload.size(), SEGMENT_SIZE ) == payload.size() );
+   REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+
+   for ( size_t i = 0; i <= SEGMENT_COUNT; ++i )
+   {
+      const size_t nExpected = ( i < SEGMENT_COUNT ) ? SEGMENT_SIZE : SEGMENT_SIZE / 2;
+      REQUIRE( server.Receive( 1024 ) == nExpected );
+      REQUIRE( server.GetData() == std::string( nExpected, static_cast<char>( i ) ) );
+   }
+
+   SECTION( "Stream sockets" )
+   {
+      CActiveSocket stream;
+      REQUIRE( stream.SendSegmented( payload.data(), payload.size(), SEGMENT_SIZE ) == CSimpleSocket::SocketError );
+      REQUIRE( stream.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+}
+
+TEST_CASE( "Sockets can receive coalesced", "[Receive][UDP]" )
+{
+   static constexpr uint16_t SEGMENT_SIZE = 100;
+   static constexpr size_t SEGMENT_COUNT = 10;
+
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::vector<uint8_t> payload( SEGMENT_SIZE * SEGMENT_COUNT );
+   for ( size_t i = 0; i < payload.size(); ++i ) payload[ i ] = static_cast<uint8_t>( i / SEGMENT_SIZE );
+
+   std::vector<uint8_t> buffer( 1 << 16 );
+   uint16_t nSegmentSize = 0;
+   size_t nReceived = 0;
+   size_t nCalls = 0;
+   bool bCoalescing = false;
+
+   SECTION( "Enabled" )
+   {
+#ifdef _LINUX
+      REQUIRE( server.SetReceiveCoalescing( true ) );
+      bCoalescing = true;
+#else
+      REQUIRE_FALSE( server.SetReceiveCoalescing( true ) );
+#endif
+   }
+
+   SECTION( "Disabled" )
+   {
+      REQUIRE( server.SetReceiveCoalescing( false ) );
+   }
+
+   REQUIRE( socket.SendSegmented( payload.data(), payload.size(), SEGMENT_SIZE ) == payload.size() );
+
+   while ( nReceived < payload.size() )
+   {
+      const int32_t nBytes = server.ReceiveCoalesced( buffer.data(), buffer.size(), nSegmentSize );
+      REQUIRE( nBytes > 0 );
+      REQUIRE( nSegmentSize == SEGMENT_SIZE );
+      REQUIRE( std::equal( buffer.begin(), buffer.begin() + nBytes, payload.begin() + nReceived ) );
+
+      nReceived += nBytes;
+      ++nCalls;
+   }
+
+   REQUIRE( nReceived == payload.size() );
+   CHECK( ( bCoalescing ? nCalls < SEGMENT_COUNT : nCalls == SEGMENT_COUNT ) );
+
+   SECTION( "Stream sockets" )
+   {
+      CActiveSocket stream;
+      REQUIRE_FALSE( stream.SetReceiveCoalescing( true ) );
+      REQUIRE( stream.GetSocketError() == CSimpleSocket::SocketProtocolError );
+   }
+}
+
+TEST_CASE( "Sockets can send files", "[Send][TCP]" )
+{
+   static constexpr size_t FILE_SIZE = 4 * 1024 * 1024;
+
+   std::FILE* pFile = std::tmpfile();
+   REQUIRE( pFile != nullptr );
+
+   std::vector<uint8_t> contents( FILE_SIZE );
+   for ( size_t i = 0; i < contents.size(); ++i ) contents[ i ] = static_cast<uint8_t>( i * 7 );
+   REQUIRE( std::fwrite( contents.data(), 1, contents.size(), pFile ) == contents.size() );
+   REQUIRE( std::fflush( pFile ) == 0 );
+   const int nFile = fileno( pFile );
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   // Drains the connection while the file is being sent
+   const auto receiveAll = [&]( size_t nExpected ) {
+      return std::async( std::launch::async, [&connection, nExpected] {
+         std::vector<uint8_t> received( nExpected );
+         size_t nReceived = 0;
+         while ( nReceived < nExpected )
+         {
+            const int32_t nBytes = connection->Receive( static_cast<uint32_t>( nExpected - nReceived ),
+                                                        received.data() + nReceived );
+            if ( nBytes <= 0 ) break;
+            nReceived += nBytes;
+         }
+         received.resize( nReceived );
+         return received;
+      } );
+   };
+
+   SECTION( "Blocking" )
+   {
+      auto received = receiveAll( FILE_SIZE - 1000 );
+      REQUIRE( socket.SendFile( nFile, 1000, FILE_SIZE ) == FILE_SIZE - 1000 );   // Stops at the end of the file
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
+      REQUIRE( received.get() == std::vector<uint8_t>( contents.begin() + 1000, contents.end() ) );
+   }
+
+   SECTION( "Non-blocking" )
+   {
+      REQUIRE( socket.SetNonblocking() );
+      auto received = receiveAll( FILE_SIZE );
+
+      int64_t nSent = 0;
+      while ( nSent < static_cast<int64_t>( FILE_SIZE ) )
+      {
+         const int64_t nResult = socket.SendFile( nFile, nSent, FILE_SIZE - nSent );
+         if ( nResult == CSimpleSocket::SocketError )
+         {
+            REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketEwouldblock );
+            REQUIRE( socket.Select( CSimpleSocket::ReadinessWritable, 5, 0 ) );
+            continue;
+         }
+
+         nSent += nResult;
+      }
+
+      REQUIRE( received.get() == contents );
+   }
+
+   SECTION( "Invalid file" )
+   {
+      REQUIRE( socket.SendFile( -1, 0, FILE_SIZE ) == CSimpleSocket::SocketError );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+   }
+
+   std::fclose( pFile );
+}
+
+TEST_CASE( "Sockets can send zero copy", "[Send][TCP]" )
+{
+   static constexpr size_t CHUNK_SIZE = 256 * 1024;
+   static constexpr size_t CHUNK_COUNT = 8;
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   const std::vector<uint8_t> payload( CHUNK_SIZE, 'z' );
+   uint32_t nId = 0;
+
+   SECTION( "Not enabled" )
+   {
+      REQUIRE( socket.SendZeroCopy( payload.data(), payload.size(), nId ) == CSimpleSocket::SocketError );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketInvalidOperation );
+   }
+
+#ifdef _LINUX
+   SECTION( "Enabled" )
+   {
+      REQUIRE( socket.SetZeroCopy( true ) );
+
+      auto draining = std::async( std::launch::async, [&] {
+         size_t nReceived = 0;
+         while ( nReceived < CHUNK_SIZE * CHUNK_COUNT && connection->Receive( 64 * 1024 ) > 0 )
+         {
+            nReceived += connection->GetBytesReceived();
+         }
+         return nReceived;
+      } );
+
+      // Every chunk is sent from the same buffer, which is never modified
+      uint32_t nLastId = 0;
+      for ( size_t nSent = 0; nSent < CHUNK_SIZE * CHUNK_COUNT; )
+      {
+         const size_t nOffset = nSent % CHUNK_SIZE;
+         const int32_t nBytes = socket.SendZeroCopy( payload.data() + nOffset, CHUNK_SIZE - nOffset, nId );
+         REQUIRE( nBytes > 0 );
+         REQUIRE( nId == nLastId + ( nSent > 0 ? 1 : 0 ) );
+
+         nLastId = nId;
+         nSent += nBytes;
+      }
+
+      REQUIRE( draining.get() == CHUNK_SIZE * CHUNK_COUNT );
+
+      // Ranges arrive in order and together cover every send
+      std::vector<CSimpleSocket::CZeroCopyCompletion> completions;
+      uint32_t nReleased = 0;
+      while ( nReleased <= nLastId )
+      {
+         REQUIRE( ( socket.Select( CSimpleSocket::ReadinessNone, 5, 0 ) ||
+                    ( socket.GetReadiness() & CSimpleSocket::ReadinessErrored ) ) );
+         REQUIRE( socket.ReapZeroCopyCompletions( completions ) >= 0 );
+
+         for ( const auto& completion : completions )
+         {
+            REQUIRE( completion.nFirst == nReleased );
+            nReleased = completion.nLast + 1;
+         }
+         completions.clear();
+      }
+
+      REQUIRE( socket.ReapZeroCopyCompletions( completions ) == 0 );
+   }
+#else
+   REQUIRE_FALSE( socket.SetZeroCopy( true ) );
+#endif
+}
+
 TEST_CASE( "Sockets can linger", "[Linger]" )
 {
    auto time = GENERATE( range<uint16_t>( 0, 90, 15 ) );
@@ -1523,6 +2301,25 @@ TEST_CASE( "Sockets can be flushed", "[Flush]" )
       CHECK( socket.GetSocketError() == CSimpleSocket::SocketSuccess );
    }
 
+   SECTION( "Stream is unchanged" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket;
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+      REQUIRE( socket.Flush() );
+      REQUIRE( socket.Shutdown( CSimpleSocket::Sends ) );
+
+      REQUIRE( connection->ReceiveExactly( nullptr, TEXT_PACKET_LENGTH + 1 ) == TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetData() == TEXT_PACKET );
+   }
+
    SECTION( "UDP" )
    {
       CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
@@ -1549,6 +2346,65 @@ TEST_CASE( "Sockets can be flushed", "[Flush]" )
    }
 }
 
+TEST_CASE( "Sockets can be corked", "[Cork][Send][TCP]" )
+{
+   static constexpr auto HEADER = "HEAD"sv;
+
+   SECTION( "TCP" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket;
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      REQUIRE( socket.Cork() );
+      REQUIRE( socket.IsCorked() );
+
+      REQUIRE( socket.Send( reinterpret_cast<const uint8_t*>( HEADER.data() ), HEADER.length(),
+                            CSimpleSocket::SendMore ) == HEADER.length() );
+      REQUIRE( socket.Send( TEXT_PACKET ) == TEXT_PACKET_LENGTH );
+
+      SECTION( "Uncork" ) { REQUIRE( socket.Uncork() ); }
+      SECTION( "Flush" ) { REQUIRE( socket.Flush() ); }
+
+      REQUIRE( connection->ReceiveExactly( nullptr, HEADER.length() + TEXT_PACKET_LENGTH, 1000 ) ==
+               HEADER.length() + TEXT_PACKET_LENGTH );
+      REQUIRE( connection->GetData() == std::string( HEADER ) + std::string( TEXT_PACKET ) );
+   }
+
+   SECTION( "Flush without Nagle" )
+   {
+      CPassiveSocket server;
+      REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+      CActiveSocket socket;
+      REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+      REQUIRE( socket.DisableNagleAlgoritm() );
+
+      std::unique_ptr<CActiveSocket> connection = server.Accept();
+      REQUIRE( connection != nullptr );
+
+      // Held back by SendMore, which Nagle being off does not push out, well short of the 200ms
+      // the kernel waits for more
+      REQUIRE( socket.Send( reinterpret_cast<const uint8_t*>( HEADER.data() ), HEADER.length(),
+                            CSimpleSocket::SendMore ) == HEADER.length() );
+      REQUIRE( socket.Flush() );
+      REQUIRE( connection->ReceiveExactly( nullptr, HEADER.length(), 100 ) == HEADER.length() );
+   }
+
+   SECTION( "UDP" )
+   {
+      CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+      REQUIRE_FALSE( socket.Cork() );
+      REQUIRE( socket.GetSocketError() == CSimpleSocket::SocketProtocolError );
+      REQUIRE_FALSE( socket.IsCorked() );
+   }
+}
+
 TEST_CASE( "Sockets can set nagle on/off", "[Nagle]" )
 {
    SECTION( "TCP" )
@@ -1869,3 +2725,19 @@ TEST_CASE( "Sockets can set tcp tx windows size", "[!mayfail][TCP][UDP]" )
       }
    }
 }
+
+TEST_CASE( "Data views compare", "[DataView]" )
+{
+   const std::string sText = "view";
+   const CDataView view( sText.data(), sText.size() );
+   const CDataView other( "other", 5 );
+
+   CHECK( view == view );
+   CHECK_FALSE( view != view );
+   CHECK( view != other );
+   CHECK( view == sText );
+   CHECK( sText == view );
+   CHECK( "view" == view );
+   CHECK( view != "other" );
+   CHECK( std::string( "other" ) != view );
+}
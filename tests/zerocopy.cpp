@@ -0,0 +1,123 @@
+/*
+
+MIT License
+
+Copyright (c) 2019 Chris McArthur, prince.chrismc(at)gmail(dot)com
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*/
+
+#include "catch2/catch.hpp"
+#include "PassiveSocket.h"
+#include "ZeroCopyReceiver.h"
+
+#include <cerrno>
+#include <future>
+#include <vector>
+
+#ifdef _LINUX
+
+TEST_CASE( "Zero copy receivers deliver the stream", "[ZeroCopy][Receive][TCP]" )
+{
+   static constexpr size_t STREAM_SIZE = 8 * 1024 * 1024 + 123;   // Ends on a partial page
+
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   std::vector<uint8_t> stream( STREAM_SIZE );
+   for ( size_t i = 0; i < stream.size(); ++i ) stream[ i ] = static_cast<uint8_t>( i % 251 );
+
+   auto sending = std::async( std::launch::async, [&] {
+      const bool bSent = socket.Send( stream.data(), stream.size() ) == static_cast<int32_t>( stream.size() );
+      socket.Shutdown( CSimpleSocket::Sends );
+      return bSent;
+   } );
+
+   CZeroCopyReceiver receiver( *connection, 256 * 1024 );
+   CZeroCopyReceiver::CChunk chunk;
+   std::vector<uint8_t> received;
+   received.reserve( STREAM_SIZE );
+
+   int32_t nBytes = 0;
+   while ( ( nBytes = receiver.Receive( chunk ) ) > 0 )
+   {
+      REQUIRE( chunk.GetSize() == static_cast<size_t>( nBytes ) );
+      REQUIRE( connection->GetBytesReceived() == nBytes );
+      received.insert( received.end(), chunk.pMapped, chunk.pMapped + chunk.nMapped );
+      received.insert( received.end(), chunk.pCopied, chunk.pCopied + chunk.nCopied );
+   }
+
+   REQUIRE( nBytes == 0 );
+   REQUIRE( sending.get() );
+   REQUIRE( received == stream );
+}
+
+TEST_CASE( "Zero copy receivers copy what can not be mapped", "[ZeroCopy][Receive][TCP]" )
+{
+   CPassiveSocket server;
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CActiveSocket socket;
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+
+   std::unique_ptr<CActiveSocket> connection = server.Accept();
+   REQUIRE( connection != nullptr );
+
+   CZeroCopyReceiver receiver( *connection );
+
+   // Less than a page is never mapped, the kernel hints to copy it instead
+   REQUIRE( socket.Send( "partial page" ) == 12 );
+   REQUIRE( connection->Select( CSimpleSocket::ReadinessReadable, 1, 0 ) );
+
+   // A successful call leaves errno alone, an earlier interrupted one must not cause a retry
+   errno = EINTR;
+
+   CZeroCopyReceiver::CChunk chunk;
+   REQUIRE( receiver.Receive( chunk ) == 12 );
+   CHECK( chunk.nMapped == 0 );
+   CHECK( std::string( reinterpret_cast<const char*>( chunk.pCopied ), chunk.nCopied ) == "partial page" );
+   CHECK( connection->GetSocketError() == CSimpleSocket::SocketSuccess );
+}
+
+TEST_CASE( "Zero copy receivers fall back to copying", "[ZeroCopy][Receive][UDP]" )
+{
+   CPassiveSocket server( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( server.Listen( "127.0.0.1", 0 ) );
+
+   CZeroCopyReceiver receiver( server );
+   REQUIRE_FALSE( receiver.IsMapping() );
+
+   CActiveSocket socket( CSimpleSocket::SocketTypeUdp );
+   REQUIRE( socket.Open( "127.0.0.1", server.GetServerPort() ) );
+   REQUIRE( socket.Send( "datagram" ) == 8 );
+
+   CZeroCopyReceiver::CChunk chunk;
+   REQUIRE( receiver.Receive( chunk ) == 8 );
+   REQUIRE( chunk.nMapped == 0 );
+   REQUIRE( std::string( reinterpret_cast<const char*>( chunk.pCopied ), chunk.nCopied ) == "datagram" );
+}
+
+#endif